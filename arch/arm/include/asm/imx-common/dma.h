@@ -24,6 +24,13 @@
 
 #define MXS_DMA_ALIGNMENT	32
 
+/* Number of descriptors preallocated by mxs_dma_desc_alloc() */
+#ifndef	CONFIG_MXS_DMA_DESC_POOL_SIZE
+#define	MXS_DMA_DESC_POOL_SIZE	16
+#else
+#define	MXS_DMA_DESC_POOL_SIZE	CONFIG_MXS_DMA_DESC_POOL_SIZE
+#endif
+
 /*
  * MXS DMA channels
  */
@@ -137,10 +144,26 @@ struct mxs_dma_desc {
  */
 #define	MXS_DMA_FLAGS_IDLE	0
 #define	MXS_DMA_FLAGS_BUSY	(1 << 0)
+#define	MXS_DMA_FLAGS_SUBMITTED	(1 << 1)
 #define	MXS_DMA_FLAGS_FREE	0
 #define	MXS_DMA_FLAGS_ALLOCATED	(1 << 16)
 #define	MXS_DMA_FLAGS_VALID	(1 << 31)
 
+/*
+ * A cookie identifies one chain handed to mxs_dma_submit(). The low bits
+ * hold the channel number, the rest is a per-channel sequence number.
+ */
+typedef int mxs_dma_cookie_t;
+
+#define	MXS_DMA_COOKIE_CHAN_BITS	5
+#define	MXS_DMA_COOKIE_CHAN_MASK	((1 << MXS_DMA_COOKIE_CHAN_BITS) - 1)
+
+/*
+ * Completion callback, called from the poll loop once the chain submitted
+ * on the channel has finished. Status is zero or -ETIMEDOUT.
+ */
+typedef void (*mxs_dma_callback_t)(int chan, int status, void *data);
+
 struct mxs_dma_chan {
 	const char *name;
 	unsigned long dev;
@@ -150,6 +173,10 @@ struct mxs_dma_chan {
 	unsigned int pending_num;
 	struct list_head active;
 	struct list_head done;
+	mxs_dma_cookie_t cookie;
+	mxs_dma_cookie_t completed;
+	mxs_dma_callback_t callback;
+	void *callback_data;
 };
 
 struct mxs_dma_desc *mxs_dma_desc_alloc(void);
@@ -157,6 +184,11 @@ void mxs_dma_desc_free(struct mxs_dma_desc *);
 int mxs_dma_desc_append(int channel, struct mxs_dma_desc *pdesc);
 
 int mxs_dma_go(int chan);
+mxs_dma_cookie_t mxs_dma_submit(int chan, mxs_dma_callback_t callback,
+				void *data);
+int mxs_dma_is_done(mxs_dma_cookie_t cookie);
+int mxs_dma_wait(mxs_dma_cookie_t cookie, uint32_t timeout);
+void mxs_dma_poll(void);
 void mxs_dma_init(void);
 int mxs_dma_init_channel(int chan);
 int mxs_dma_release(int chan);
@@ -70,3 +70,7 @@ phys_addr_t map_to_sysmem(const void *ptr)
 void flush_dcache_range(unsigned long start, unsigned long stop)
 {
 }
+
+void invalidate_dcache_range(unsigned long start, unsigned long stop)
+{
+}
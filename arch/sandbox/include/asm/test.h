@@ -23,4 +23,12 @@ void sandbox_i2c_eeprom_set_test_mode(struct udevice *dev,
 
 void sandbox_i2c_eeprom_set_offset_len(struct udevice *dev, int offset_len);
 
+/**
+ * sandbox_dcp_packet_count() - Number of packets the DCP model has run
+ *
+ * Lets tests check that the mxs_dcp driver really used the engine rather
+ * than falling back to software.
+ */
+int sandbox_dcp_packet_count(void);
+
 #endif
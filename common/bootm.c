@@ -21,6 +21,9 @@
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
+#if defined(CONFIG_CMD_UBI) && defined(CONFIG_MTD_UBI_DEFER_WORK)
+#include <ubi_uboot.h>
+#endif
 #else
 #include "mkimage.h"
 #endif
@@ -29,11 +32,6 @@
 #include <bootm.h>
 #include <image.h>
 
-#ifndef CONFIG_SYS_BOOTM_LEN
-/* use 8MByte as default max gunzip size */
-#define CONFIG_SYS_BOOTM_LEN	0x800000
-#endif
-
 #define IH_INITRD_ARCH IH_ARCH_DEFAULT
 
 #ifndef USE_HOSTCC
@@ -62,12 +60,15 @@ static void boot_start_lmb(bootm_headers_t *images)
 }
 #else
 #define lmb_reserve(lmb, base, size)
+#define lmb_release(lmb)
 static inline void boot_start_lmb(bootm_headers_t *images) { }
 #endif
 
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+	/* A bootm that failed may have left the lmb tables allocated */
+	lmb_release(&images.lmb);
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = getenv_yesno("verify");
 
@@ -319,6 +320,36 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 	return BOOTM_ERR_RESET;
 }
 
+#ifdef CONFIG_GZIP
+/*
+ * With CONFIG_GUNZIP_ON_LOAD the image may already have been inflated to
+ * load_buf while it was loaded; otherwise inflate it now. Either way the
+ * time spent inflating is accumulated in bootstage as "decompress".
+ */
+static int bootm_gunzip(void *load_buf, uint unc_len, void *image_buf,
+			ulong *image_len)
+{
+	ulong size;
+	int ret;
+
+	if (!gunzip_load_lookup(image_buf, *image_len, load_buf, unc_len,
+				&size)) {
+		*image_len = size;
+		return 0;
+	}
+
+#ifndef USE_HOSTCC
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decompress");
+#endif
+	ret = gunzip(load_buf, unc_len, image_buf, image_len);
+#ifndef USE_HOSTCC
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
+#endif
+
+	return ret;
+}
+#endif /* CONFIG_GZIP */
+
 int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		       void *load_buf, void *image_buf, ulong image_len,
 		       uint unc_len, ulong *load_end)
@@ -344,7 +375,7 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 #ifdef CONFIG_GZIP
 	case IH_COMP_GZIP: {
-		ret = gunzip(load_buf, unc_len, image_buf, &image_len);
+		ret = bootm_gunzip(load_buf, unc_len, image_buf, &image_len);
 		break;
 	}
 #endif /* CONFIG_GZIP */
@@ -486,6 +517,11 @@ ulong bootm_disable_interrupts(void)
 	 */
 	usb_stop();
 #endif
+
+#if defined(CONFIG_CMD_UBI) && defined(CONFIG_MTD_UBI_DEFER_WORK)
+	/* Do not leave UBI erase or wear-leveling work behind */
+	ubi_flush_deferred_works();
+#endif
 	return iflag;
 }
 
@@ -606,6 +642,15 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		argc = 0;	/* consume the args */
 	}
 
+	/*
+	 * From here on images are moved and decompressed, possibly over the
+	 * file they came from, so digests taken while it was loaded no
+	 * longer describe memory.
+	 */
+	if (!ret && (states & (BOOTM_STATE_LOADOS | BOOTM_STATE_RAMDISK |
+			       BOOTM_STATE_FDT)))
+		hash_load_drop();
+
 	/* Load the OS */
 	if (!ret && (states & BOOTM_STATE_LOADOS)) {
 		ulong load_end;
@@ -0,0 +1,72 @@
+/*
+ * Compare the CRC32 implementations in lib/crc32.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <watchdog.h>
+#include <u-boot/crc.h>
+
+/* Run each variant for at least this long */
+#define CRC32_BENCH_MS		1000
+
+static int do_crc32bench(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	const struct crc32_variant *var;
+	ulong addr, len, start, ms;
+	const unsigned char *buf;
+	uint32_t crc, ref = 0;
+	u64 bytes, kib_s;
+	int ret = CMD_RET_SUCCESS;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	addr = simple_strtoul(argv[1], NULL, 16);
+	len = simple_strtoul(argv[2], NULL, 16);
+	if (!len)
+		return CMD_RET_USAGE;
+	buf = map_sysmem(addr, len);
+
+	printf("%-12s %8s %10s %10s\n", "variant", "tables", "crc32", "MiB/s");
+	for (var = crc32_variants; var->name; var++) {
+		bytes = 0;
+		crc = var->crc(~0U, buf, len) ^ ~0U;
+		start = get_timer(0);
+		do {
+			var->crc(~0U, buf, len);
+			bytes += len;
+			WATCHDOG_RESET();
+			ms = get_timer(start);
+		} while (ms < CRC32_BENCH_MS);
+
+		kib_s = bytes * 1000;
+		do_div(kib_s, ms * 1024);
+		printf("%-12s %8u   %08x %7lu.%02lu\n", var->name,
+		       var->table_size, crc, (ulong)kib_s / 1024,
+		       ((ulong)kib_s % 1024) * 100 / 1024);
+
+		if (var == crc32_variants)
+			ref = crc;
+		else if (crc != ref)
+			ret = CMD_RET_FAILURE;
+	}
+	unmap_sysmem(buf);
+
+	if (ret)
+		puts("Variants disagree!\n");
+
+	return ret;
+}
+
+U_BOOT_CMD(
+	crc32bench,	3,	0,	do_crc32bench,
+	"compare the speed of the CRC32 implementations",
+	"address count\n"
+	"    - checksum count bytes at address with each CRC32 variant\n"
+	"      and report its table size, result and throughput"
+);
@@ -0,0 +1,102 @@
+/*
+ * Show how the malloc() pool is used
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <trace.h>
+#include <asm/io.h>
+
+static int do_malloc_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	printf("Heap at %08lx-%08lx, %lu KiB\n", mem_malloc_start,
+	       mem_malloc_end, (mem_malloc_end - mem_malloc_start) >> 10);
+	printf("Top at %08lx, %lu KiB never used\n", mem_malloc_brk,
+	       (mem_malloc_end - mem_malloc_brk) >> 10);
+#ifdef CONFIG_SYS_MALLOC_SLAB
+	malloc_slab_stats();
+#endif
+#ifdef CONFIG_TRACE_HEAP
+	trace_heap_stats();
+#endif
+
+	return 0;
+}
+
+#ifdef CONFIG_TRACE_HEAP
+/* Same buffer and variables as 'trace calls', so the two can share a file */
+static int do_malloc_trace(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	size_t buff_size, avail, buff_ptr, used;
+	unsigned int needed;
+	char *buff;
+
+	if (argc == 3) {
+		buff_size = simple_strtoul(argv[2], NULL, 16);
+		buff = map_sysmem(simple_strtoul(argv[1], NULL, 16),
+				  buff_size);
+		buff_ptr = 0;
+	} else if (argc == 1) {
+		buff_size = getenv_ulong("profsize", 16, 0);
+		buff = map_sysmem(getenv_ulong("profbase", 16, 0), buff_size);
+		buff_ptr = getenv_ulong("profoffset", 16, 0);
+	} else {
+		return CMD_RET_USAGE;
+	}
+	if (buff_ptr > buff_size)
+		return CMD_RET_USAGE;
+
+	avail = buff_size - buff_ptr;
+	if (trace_list_heap(buff + buff_ptr, avail, &needed))
+		printf("Error: truncated (%#x bytes needed)\n", needed);
+	used = min(avail, (size_t)needed);
+	printf("Heap trace dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+
+	setenv_hex("profbase", map_to_sysmem(buff));
+	setenv_hex("profsize", buff_size);
+	setenv_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+#endif
+
+static cmd_tbl_t cmd_malloc_sub[] = {
+	U_BOOT_CMD_MKENT(info, 1, 1, do_malloc_info, "", ""),
+#ifdef CONFIG_TRACE_HEAP
+	U_BOOT_CMD_MKENT(trace, 3, 0, do_malloc_trace, "", ""),
+#endif
+};
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading 'malloc' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_malloc_sub, ARRAY_SIZE(cmd_malloc_sub));
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	malloc,	4,	1,	do_malloc,
+	"malloc() pool",
+	"info - show the heap and the use of each slab size class"
+#ifdef CONFIG_TRACE_HEAP
+	"\nmalloc trace [<addr> <size>] - dump the heap trace into a buffer"
+#endif
+);
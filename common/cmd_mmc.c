@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <hash.h>
 #include <mmc.h>
 
 static int curr_device = -1;
@@ -350,9 +351,12 @@ static int do_mmc_read(cmd_tbl_t *cmdtp, int flag,
 	printf("\nMMC read: dev # %d, block # %d, count %d ... ",
 	       curr_device, blk, cnt);
 
+	hash_load_start(addr);
 	n = mmc->block_dev.block_read(curr_device, blk, cnt, addr);
 	/* flush cache after read */
 	flush_cache((ulong)addr, cnt * 512); /* FIXME */
+	if (n == cnt)
+		hash_load_end(addr, cnt * 512);
 	printf("%d blocks read: %s\n", n, (n == cnt) ? "OK" : "ERROR");
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
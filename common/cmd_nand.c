@@ -22,6 +22,7 @@
 #include <common.h>
 #include <linux/mtd/mtd.h>
 #include <command.h>
+#include <hash.h>
 #include <watchdog.h>
 #include <malloc.h>
 #include <asm/byteorder.h>
@@ -397,6 +398,9 @@ static void nand_print_and_set_info(int idx)
 	printf("  Page size  %8d b\n", nand->writesize);
 	printf("  OOB size   %8d b\n", nand->oobsize);
 	printf("  Erase size %8d b\n", nand->erasesize);
+#ifdef CONFIG_NAND_MXS
+	mxs_nand_print_stats(nand);
+#endif
 
 	/* Set geometry info */
 	setenv_hex("nand_writesize", nand->writesize);
@@ -686,11 +690,14 @@ static int do_nand(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 		if (!s || !strcmp(s, ".jffs2") ||
 		    !strcmp(s, ".e") || !strcmp(s, ".i")) {
-			if (read)
+			if (read) {
+				hash_load_start((void *)addr);
 				ret = nand_read_skip_bad(nand, off, &rwsize,
 							 NULL, maxsize,
 							 (u_char *)addr);
-			else
+				if (!ret)
+					hash_load_end((void *)addr, rwsize);
+			} else
 				ret = nand_write_skip_bad(nand, off, &rwsize,
 							  NULL, maxsize,
 							  (u_char *)addr,
@@ -942,6 +949,7 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 	}
 	bootstage_mark(BOOTSTAGE_ID_NAND_TYPE);
 
+	hash_load_start((void *)addr);
 	r = nand_read_skip_bad(nand, offset, &cnt, NULL, nand->size,
 			(u_char *)addr);
 	if (r) {
@@ -950,6 +958,7 @@ static int nand_load_image(cmd_tbl_t *cmdtp, nand_info_t *nand,
 		return 1;
 	}
 	bootstage_mark(BOOTSTAGE_ID_NAND_READ);
+	hash_load_end((void *)addr, cnt);
 
 #if defined(CONFIG_FIT)
 	/* This cannot be done earlier, we need complete FIT image in RAM first */
@@ -10,6 +10,7 @@
  */
 #include <common.h>
 #include <command.h>
+#include <hash.h>
 #include <net.h>
 
 static int netboot_common(enum proto_t, cmd_tbl_t *, int, char * const []);
@@ -228,6 +229,10 @@ static int netboot_common(enum proto_t proto, cmd_tbl_t *cmdtp, int argc,
 	}
 	bootstage_mark(BOOTSTAGE_ID_NET_START);
 
+#ifdef CONFIG_CMD_TFTPPUT
+	if (proto != TFTPPUT)
+#endif
+		hash_load_start((void *)load_addr);
 	if ((size = NetLoop(proto)) < 0) {
 		bootstage_error(BOOTSTAGE_ID_NET_NETLOOP_OK);
 		return 1;
@@ -245,6 +250,7 @@ static int netboot_common(enum proto_t proto, cmd_tbl_t *cmdtp, int argc,
 
 	/* flush cache */
 	flush_cache(load_addr, size);
+	hash_load_end((void *)load_addr, size);
 
 	bootstage_mark(BOOTSTAGE_ID_NET_LOADED);
 
@@ -0,0 +1,253 @@
+/*
+ * Store a file received by TFTP straight into UBI, NAND or MMC
+ *
+ * The file is not staged in RAM: each chunk is written while the next
+ * blocks are already on their way, see struct tftp_sink.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <net.h>
+#ifdef CONFIG_CMD_NAND
+#include <nand.h>
+#endif
+#ifdef CONFIG_CMD_MMC
+#include <mmc.h>
+#endif
+#ifdef CONFIG_CMD_UBI
+#include <ubi_uboot.h>
+#endif
+
+/* Chunk size for sinks without a natural one */
+#define TFTPSTORE_MMC_CHUNK	(256 << 10)
+
+struct tftpstore {
+	struct tftp_sink sink;
+	char name[40];
+	char *volume;		/* UBI volume name */
+	ulong total;		/* UBI update size */
+#ifdef CONFIG_CMD_NAND
+	nand_info_t *nand;
+#endif
+	loff_t start;		/* first NAND byte or MMC block */
+	loff_t end;		/* end of the NAND range */
+	loff_t pos;		/* next NAND byte to program */
+	int dev;		/* MMC device */
+};
+
+#ifdef CONFIG_CMD_UBI
+static int ubi_sink_start(struct tftp_sink *sink, ulong total)
+{
+	struct tftpstore *ts = sink->priv;
+
+	/* A volume update has to know its size up front */
+	if (!total) {
+		puts("\nUBI: server did not report the file size (tsize)\n");
+		return -EINVAL;
+	}
+	ts->total = total;
+
+	return 0;
+}
+
+static int ubi_sink_write(struct tftp_sink *sink, ulong offset, uchar *buf,
+			  ulong len)
+{
+	struct tftpstore *ts = sink->priv;
+
+	if (!offset)
+		return ubi_volume_begin_write(ts->volume, buf, len, ts->total);
+
+	return ubi_volume_continue_write(ts->volume, buf, len);
+}
+
+static int ubi_sink_finish(struct tftp_sink *sink, ulong total)
+{
+	struct tftpstore *ts = sink->priv;
+
+	if (total != ts->total) {
+		printf("\nUBI: got %lu of %lu bytes, volume left incomplete\n",
+		       total, ts->total);
+		return -EIO;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_CMD_UBI */
+
+#ifdef CONFIG_CMD_NAND
+static int nand_sink_start(struct tftp_sink *sink, ulong total)
+{
+	struct tftpstore *ts = sink->priv;
+
+	ts->pos = ts->start;
+	if (total > ts->end - ts->start) {
+		printf("\nNAND: file (%lu bytes) does not fit the range\n",
+		       total);
+		return -EFBIG;
+	}
+
+	return 0;
+}
+
+/* Each chunk is one erase block, programmed into the next good block */
+static int nand_sink_write(struct tftp_sink *sink, ulong offset, uchar *buf,
+			   ulong len)
+{
+	struct tftpstore *ts = sink->priv;
+	size_t written = len;
+	int ret;
+
+	while (ts->pos < ts->end && nand_block_isbad(ts->nand, ts->pos)) {
+		printf("\nNAND: skipping bad block at 0x%llx\n", ts->pos);
+		ts->pos += ts->nand->erasesize;
+	}
+	if (ts->pos >= ts->end) {
+		puts("\nNAND: range too small\n");
+		return -EFBIG;
+	}
+
+	ret = nand_erase(ts->nand, ts->pos, ts->nand->erasesize);
+	if (!ret)
+		ret = nand_write(ts->nand, ts->pos, &written, buf);
+	if (ret) {
+		printf("\nNAND: writing block at 0x%llx failed\n", ts->pos);
+		return ret;
+	}
+	ts->pos += ts->nand->erasesize;
+
+	return 0;
+}
+#endif /* CONFIG_CMD_NAND */
+
+#ifdef CONFIG_CMD_MMC
+static int mmc_sink_write(struct tftp_sink *sink, ulong offset, uchar *buf,
+			  ulong len)
+{
+	struct tftpstore *ts = sink->priv;
+	struct mmc *mmc = find_mmc_device(ts->dev);
+	ulong blksz = mmc->block_dev.blksz;
+	lbaint_t cnt = DIV_ROUND_UP(len, blksz);
+
+	/* Pad the last block of the file */
+	memset(buf + len, 0, cnt * blksz - len);
+
+	if (mmc->block_dev.block_write(ts->dev, ts->start + offset / blksz,
+				       cnt, buf) != cnt) {
+		puts("\nMMC: write failed\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_CMD_MMC */
+
+static int do_tftpstore(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	struct tftpstore ts;
+	struct tftp_sink *sink = &ts.sink;
+	const char *file = NULL;
+	int size;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+
+	memset(&ts, 0, sizeof(ts));
+	sink->name = ts.name;
+	sink->priv = &ts;
+
+#ifdef CONFIG_CMD_UBI
+	if (!strcmp(argv[1], "ubi")) {
+		if (argc > 4)
+			return CMD_RET_USAGE;
+		if (!ubi_devices[0]) {
+			puts("No UBI device, run 'ubi part' first\n");
+			return CMD_RET_FAILURE;
+		}
+		ts.volume = argv[2];
+		snprintf(ts.name, sizeof(ts.name), "UBI volume %s", ts.volume);
+		sink->size = ubi_devices[0]->leb_size;
+		sink->start = ubi_sink_start;
+		sink->write = ubi_sink_write;
+		sink->finish = ubi_sink_finish;
+		if (argc == 4)
+			file = argv[3];
+	} else
+#endif
+#ifdef CONFIG_CMD_NAND
+	if (!strcmp(argv[1], "nand")) {
+		if (argc < 4 || argc > 5)
+			return CMD_RET_USAGE;
+		ts.nand = &nand_info[nand_curr_device];
+		ts.start = simple_strtoull(argv[2], NULL, 16);
+		ts.end = ts.start + simple_strtoull(argv[3], NULL, 16);
+		if (!ts.nand->name || ts.end > ts.nand->size ||
+		    ts.start & (ts.nand->erasesize - 1)) {
+			puts("NAND: range must start on a block and fit the device\n");
+			return CMD_RET_FAILURE;
+		}
+		snprintf(ts.name, sizeof(ts.name), "NAND 0x%llx", ts.start);
+		sink->size = ts.nand->erasesize;
+		sink->start = nand_sink_start;
+		sink->write = nand_sink_write;
+		if (argc == 5)
+			file = argv[4];
+	} else
+#endif
+#ifdef CONFIG_CMD_MMC
+	if (!strcmp(argv[1], "mmc")) {
+		struct mmc *mmc;
+
+		if (argc < 4 || argc > 5)
+			return CMD_RET_USAGE;
+		ts.dev = simple_strtoul(argv[2], NULL, 10);
+		ts.start = simple_strtoul(argv[3], NULL, 16);
+		mmc = find_mmc_device(ts.dev);
+		if (!mmc || mmc_init(mmc)) {
+			printf("MMC: no card at device %d\n", ts.dev);
+			return CMD_RET_FAILURE;
+		}
+		snprintf(ts.name, sizeof(ts.name), "MMC %d block 0x%llx",
+			 ts.dev, ts.start);
+		sink->size = TFTPSTORE_MMC_CHUNK;
+		sink->write = mmc_sink_write;
+		if (argc == 5)
+			file = argv[4];
+	} else
+#endif
+		return CMD_RET_USAGE;
+
+	if (file)
+		copy_filename(BootFile, file, sizeof(BootFile));
+
+	tftp_set_sink(sink);
+	size = NetLoop(TFTPGET);
+	tftp_set_sink(NULL);
+	if (size < 0)
+		return CMD_RET_FAILURE;
+
+	printf("%d bytes written to %s\n", size, ts.name);
+	setenv_hex("filesize", size);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	tftpstore,	5,	0,	do_tftpstore,
+	"store a file received by TFTP without staging it in RAM",
+	"target args... [[hostIPaddr:]filename]\n"
+	"    - write the file to target while it is received, where\n"
+	"      target and args are one of\n"
+#ifdef CONFIG_CMD_UBI
+	"    ubi volume        - update UBI volume (server must send tsize)\n"
+#endif
+#ifdef CONFIG_CMD_NAND
+	"    nand off size     - NAND range, bad blocks are skipped\n"
+#endif
+#ifdef CONFIG_CMD_MMC
+	"    mmc dev blk#      - MMC device dev from block blk# on\n"
+#endif
+);
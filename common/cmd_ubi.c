@@ -85,6 +85,12 @@ static void display_ubi_info(struct ubi_device *ubi)
 	ubi_msg("number of PEBs reserved for bad PEB handling: %d",
 			ubi->beb_rsvd_pebs);
 	ubi_msg("max/mean erase counter: %d/%d", ubi->max_ec, ubi->mean_ec);
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+	ubi_msg("pending/peak queued works:  %d/%d", ubi->works_count,
+			ubi->works_peak);
+	ubi_msg("deferred works: %u, total deferral %lu ms",
+			ubi->works_deferred, ubi->works_deferred_ms);
+#endif
 }
 
 static int ubi_info(int layout)
@@ -261,7 +267,7 @@ out_err:
 	return err;
 }
 
-static int ubi_volume_continue_write(char *volume, void *buf, size_t size)
+int ubi_volume_continue_write(char *volume, void *buf, size_t size)
 {
 	int err = 1;
 	struct ubi_volume *vol;
@@ -291,6 +297,13 @@ static int ubi_volume_continue_write(char *volume, void *buf, size_t size)
 
 		vol->checked = 1;
 		ubi_gluebi_updated(vol);
+
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+		/* The update is complete, erase the PEBs it released */
+		err = ubi_wl_flush(ubi, UBI_ALL, UBI_ALL);
+		if (err)
+			return -err;
+#endif
 	}
 
 	return 0;
@@ -594,8 +607,16 @@ static int do_ubi(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	if (strncmp(argv[1], "remove", 6) == 0) {
 		/* E.g., remove volume */
-		if (argc == 3)
-			return ubi_remove_vol(argv[2]);
+		if (argc == 3) {
+			int ret = ubi_remove_vol(argv[2]);
+
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+			/* Erase the PEBs of the removed volume right away */
+			if (!ret)
+				ret = -ubi_wl_flush(ubi, UBI_ALL, UBI_ALL);
+#endif
+			return ret;
+		}
 	}
 
 	if (strncmp(argv[1], "write", 5) == 0) {
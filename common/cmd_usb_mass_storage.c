@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <common.h>
 #include <command.h>
+#include <fat.h>
 #include <g_dnl.h>
 #include <part.h>
 #include <usb.h>
@@ -154,6 +155,8 @@ int do_usb_mass_storage(cmd_tbl_t *cmdtp, int flag,
 	}
 exit:
 	g_dnl_unregister();
+	/* The host may have changed any FAT volume on the device */
+	fat_invalidate();
 	return CMD_RET_SUCCESS;
 }
 
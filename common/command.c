@@ -11,6 +11,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <hash.h>
 #include <linux/ctype.h>
 
 /*
@@ -490,6 +491,7 @@ static int cmd_call(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	int result;
 
+	hash_load_command(cmdtp->name);
 	result = (cmdtp->cmd)(cmdtp, flag, argc, argv);
 	if (result)
 		debug("Command failed, result=%d", result);
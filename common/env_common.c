@@ -184,6 +184,42 @@ static inline int env_aes_cbc_crypt(env_t *env, const int enc)
 }
 #endif
 
+#ifdef CONFIG_ENV_LAZY_IMPORT
+#ifdef CONFIG_REGEX
+#error CONFIG_ENV_LAZY_IMPORT needs plain names in the callback and flags lists
+#endif
+#define ENV_IMPORT_FLAGS	H_LAZY
+
+static int env_enter_now(const char *name, const char *attributes)
+{
+	ENTRY e, *ep;
+
+	e.key = name;
+	e.data = NULL;
+	hsearch_r(e, FIND, &ep, &env_htab, 0);
+
+	return 0;
+}
+
+/*
+ * Variables bound to a callback or flags are entered right away, so the
+ * callbacks run and the values get checked just as they would without
+ * lazy import. Bindings made through ".callbacks" or ".flags" need no
+ * care here: setting those walks the whole table, which enters all.
+ */
+static void env_enter_bound(void)
+{
+	env_attr_walk(ENV_CALLBACK_LIST_STATIC, env_enter_now);
+	env_attr_walk(ENV_FLAGS_LIST_STATIC, env_enter_now);
+}
+#else
+#define ENV_IMPORT_FLAGS	0
+
+static inline void env_enter_bound(void)
+{
+}
+#endif
+
 /*
  * Check if CRC is valid and (if yes) import the environment.
  * Note that "buf" may or may not be aligned.
@@ -212,8 +248,9 @@ int env_import(const char *buf, int check)
 		return ret;
 	}
 
-	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
-			0, NULL)) {
+	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0',
+			ENV_IMPORT_FLAGS, 0, 0, NULL)) {
+		env_enter_bound();
 		gd->flags |= GD_FLG_ENV_READY;
 		return 1;
 	}
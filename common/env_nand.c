@@ -176,6 +176,32 @@ static int erase_and_write_env(const struct env_location *location,
 static unsigned char env_flags;
 #endif
 
+#ifdef CONFIG_ENV_SKIP_UNCHANGED
+static int readenv(size_t offset, u_char *buf);
+
+/*
+ * Check whether a copy on flash already holds exactly this environment.
+ * The serial number of a redundant copy is left out: it only changes
+ * when something gets written.
+ */
+static int env_unchanged(const struct env_location *location, env_t *env_new)
+{
+	env_t *env_old;
+	int ret;
+
+	env_old = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+	if (!env_old)
+		return 0;
+
+	ret = !readenv(location->erase_opts.offset, (u_char *)env_old) &&
+		env_old->crc == env_new->crc &&
+		!memcmp(env_old->data, env_new->data, ENV_SIZE);
+	free(env_old);
+
+	return ret;
+}
+#endif
+
 int saveenv(void)
 {
 	int	ret = 0;
@@ -208,6 +234,15 @@ int saveenv(void)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_ENV_SKIP_UNCHANGED
+	/* Spare the erase cycle if the current copy is the same */
+	if (gd->env_valid &&
+	    env_unchanged(&location[gd->env_valid - 1], env_new)) {
+		puts("Environment unchanged, not saving\n");
+		return 0;
+	}
+#endif
+
 #ifdef CONFIG_ENV_OFFSET_REDUND
 	env_new->flags = ++env_flags; /* increase the serial */
 	env_idx = (gd->env_valid == 1);
@@ -0,0 +1,394 @@
+/*
+ * Environment in NAND, kept as a log of changes
+ *
+ * The environment lives in a range of erase blocks. A block starts with
+ * a snapshot of the whole environment, and each "saveenv" then appends a
+ * record holding only the variables that were set or deleted since, in
+ * the format himport_r() takes: "name=value" sets, a bare "name" deletes.
+ * Every record starts on a page of its own, so no page is programmed
+ * twice. Only when the block is full is a new snapshot written to the
+ * next good block, and that is the only time anything gets erased.
+ *
+ * Every record carries a sequence number and CRCs over its header and
+ * data. On load the block with the newest valid snapshot wins, and its
+ * records are replayed in order up to the first one that is missing or
+ * broken. A record torn by a power cut thus fails its CRC and is dropped,
+ * as is a snapshot torn while compacting, which leaves the previous block
+ * in use.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <environment.h>
+#include <linux/stddef.h>
+#include <malloc.h>
+#include <nand.h>
+#include <search.h>
+#include <errno.h>
+
+#define ENV_LOG_MAGIC		0x4c564e45	/* "ENVL" */
+#define ENV_LOG_SNAPSHOT	1
+#define ENV_LOG_DELTA		2
+
+struct env_log_hdr {
+	uint32_t magic;
+	uint32_t type;
+	uint32_t seq;
+	uint32_t len;		/* of the data that follows */
+	uint32_t data_crc;
+	uint32_t hdr_crc;	/* of the fields above */
+};
+
+char *env_name_spec = "NAND log";
+
+env_t *env_ptr;
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static struct env_log {
+	int valid;		/* 'block' holds a valid snapshot */
+	loff_t block;		/* block in use */
+	loff_t next;		/* first free page in it */
+	uint32_t seq;		/* of the last record written */
+	char *image;		/* the environment as on flash */
+	u_char *rec;		/* one record, see env_log_rec_len() */
+} envlog;
+
+int env_init(void)
+{
+	/* use default */
+	gd->env_addr = (ulong)&default_environment[0];
+	gd->env_valid = 1;
+
+	return 0;
+}
+
+/* Space a record with 'len' bytes of data takes up */
+static size_t env_log_rec_len(size_t len)
+{
+	return roundup(sizeof(struct env_log_hdr) + len,
+		       nand_info[0].writesize);
+}
+
+static inline char *env_log_data(void)
+{
+	return (char *)envlog.rec + sizeof(struct env_log_hdr);
+}
+
+/* Length of an exported environment, including the final '\0' */
+static size_t env_log_len(const char *env)
+{
+	const char *p = env;
+
+	while (*p)
+		p += strlen(p) + 1;
+
+	return p - env + 1;
+}
+
+static int env_log_erased(const u_char *buf, size_t len)
+{
+	while (len--)
+		if (*buf++ != 0xff)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * Read the record at 'off' into envlog.rec; returns the space it takes
+ * up, or 0 if there is no valid record that ends before 'end'.
+ */
+static size_t env_log_read(loff_t off, loff_t end)
+{
+	struct env_log_hdr *hdr = (struct env_log_hdr *)envlog.rec;
+	size_t page = nand_info[0].writesize;
+	size_t len = page, rest;
+	int ret;
+
+	ret = nand_read(&nand_info[0], off, &len, envlog.rec);
+	if (ret && ret != -EUCLEAN)
+		return 0;
+
+	if (hdr->magic != ENV_LOG_MAGIC || hdr->len > ENV_SIZE ||
+	    hdr->hdr_crc != crc32(0, envlog.rec,
+				  offsetof(struct env_log_hdr, hdr_crc)))
+		return 0;
+
+	len = env_log_rec_len(hdr->len);
+	if (off + len > end)
+		return 0;
+
+	if (len > page) {
+		rest = len - page;
+		ret = nand_read(&nand_info[0], off + page, &rest,
+				envlog.rec + page);
+		if (ret && ret != -EUCLEAN)
+			return 0;
+	}
+
+	if (hdr->data_crc != crc32(0, (u_char *)env_log_data(), hdr->len))
+		return 0;
+
+	return len;
+}
+
+/* Write the data already in envlog.rec as the next record */
+static int env_log_write(loff_t off, uint32_t type, size_t len)
+{
+	struct env_log_hdr *hdr = (struct env_log_hdr *)envlog.rec;
+	size_t rec_len = env_log_rec_len(len);
+
+	hdr->magic = ENV_LOG_MAGIC;
+	hdr->type = type;
+	/* never reuse a number, even if the write fails */
+	hdr->seq = ++envlog.seq;
+	hdr->len = len;
+	hdr->data_crc = crc32(0, (u_char *)env_log_data(), len);
+	hdr->hdr_crc = crc32(0, envlog.rec,
+			     offsetof(struct env_log_hdr, hdr_crc));
+	memset(envlog.rec + sizeof(*hdr) + len, 0xff,
+	       rec_len - sizeof(*hdr) - len);
+
+	return nand_write(&nand_info[0], off, &rec_len, envlog.rec);
+}
+
+void env_relocate_spec(void)
+{
+	nand_info_t *nand = &nand_info[0];
+	struct env_log_hdr *hdr;
+	loff_t off, end;
+	size_t len;
+
+	if (!nand->writesize ||
+	    env_log_rec_len(ENV_SIZE) > nand->erasesize) {
+		set_default_env("!NAND not usable for environment");
+		return;
+	}
+
+	envlog.image = malloc(ENV_SIZE);
+	envlog.rec = memalign(ARCH_DMA_MINALIGN, env_log_rec_len(ENV_SIZE));
+	if (!envlog.image || !envlog.rec) {
+		free(envlog.image);
+		free(envlog.rec);
+		envlog.rec = NULL;
+		set_default_env("!malloc() failed");
+		return;
+	}
+	memset(envlog.image, '\0', ENV_SIZE);
+
+	/* Find the newest snapshot */
+	for (off = CONFIG_ENV_OFFSET;
+	     off < CONFIG_ENV_OFFSET + CONFIG_ENV_RANGE;
+	     off += nand->erasesize) {
+		if (nand_block_isbad(nand, off))
+			continue;
+		hdr = (struct env_log_hdr *)envlog.rec;
+		if (!env_log_read(off, off + nand->erasesize) ||
+		    hdr->type != ENV_LOG_SNAPSHOT)
+			continue;
+		if (envlog.valid && (int32_t)(hdr->seq - envlog.seq) <= 0)
+			continue;
+
+		envlog.valid = 1;
+		envlog.block = off;
+		envlog.seq = hdr->seq;
+	}
+
+	if (!envlog.valid) {
+		set_default_env("!bad CRC");
+		return;
+	}
+
+	end = envlog.block + nand->erasesize;
+	len = env_log_read(envlog.block, end);
+	if (!len) {
+		envlog.valid = 0;
+		set_default_env("!readenv() failed");
+		return;
+	}
+	hdr = (struct env_log_hdr *)envlog.rec;
+	memcpy(envlog.image, env_log_data(), hdr->len);
+	if (!himport_r(&env_htab, envlog.image, ENV_SIZE, '\0', 0, 0,
+		       0, NULL)) {
+		error("Cannot import environment: errno = %d\n", errno);
+		envlog.valid = 0;
+		set_default_env("!import failed");
+		return;
+	}
+
+	/* Replay the changes made since */
+	for (off = envlog.block + len; off < end; off += len) {
+		len = env_log_read(off, end);
+		if (!len || hdr->type != ENV_LOG_DELTA ||
+		    hdr->seq != envlog.seq + 1) {
+			/* Anything but erased flash ends this block */
+			if (len || !env_log_erased(envlog.rec,
+						   nand->writesize))
+				off = end;
+			break;
+		}
+
+		/* These were accepted once already */
+		himport_r(&env_htab, env_log_data(), hdr->len, '\0',
+			  H_NOCLEAR | H_FORCE, 0, 0, NULL);
+		envlog.seq = hdr->seq;
+	}
+	envlog.next = off;
+	gd->flags |= GD_FLG_ENV_READY;
+
+	/* Keep what is now on flash in the same form saveenv produces */
+	hexport_r(&env_htab, '\0', 0, &envlog.image, ENV_SIZE, 0, NULL);
+}
+
+#ifdef CONFIG_CMD_SAVEENV
+/* Compare the names of two "name=value" entries */
+static int env_log_namecmp(const char *a, const char *b)
+{
+	while (*a == *b && *a != '=') {
+		++a;
+		++b;
+	}
+
+	return (*a == '=' ? 0 : (uchar)*a) - (*b == '=' ? 0 : (uchar)*b);
+}
+
+/*
+ * Put what it takes to turn 'old' into 'new', both sorted as hexport_r()
+ * leaves them, into 'out'. Returns the length, or size + 1 if the
+ * changes do not fit.
+ */
+static size_t env_log_diff(const char *old, const char *new, char *out,
+			   size_t size)
+{
+	const char *src;
+	size_t len;
+	char *p = out;
+	int cmp;
+
+	while (*old || *new) {
+		if (!*old)
+			cmp = 1;
+		else if (!*new)
+			cmp = -1;
+		else
+			cmp = env_log_namecmp(old, new);
+
+		if (cmp < 0) {
+			/* deleted: the bare name */
+			src = old;
+			len = strchr(old, '=') - old;
+		} else if (cmp > 0 || strcmp(old, new)) {
+			/* added or changed */
+			src = new;
+			len = strlen(new);
+		} else {
+			len = 0;
+		}
+
+		if (len) {
+			if (p + len + 1 > out + size)
+				return size + 1;
+			memcpy(p, src, len);
+			p[len] = '\0';
+			p += len + 1;
+		}
+
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			new += strlen(new) + 1;
+	}
+
+	return p - out;
+}
+
+/* Write a snapshot to the next good block after the one in use */
+static int env_log_compact(const char *env_new)
+{
+	nand_info_t *nand = &nand_info[0];
+	loff_t start = CONFIG_ENV_OFFSET, end = start + CONFIG_ENV_RANGE;
+	loff_t off = envlog.valid ? envlog.block : end - nand->erasesize;
+	size_t len = env_log_len(env_new);
+	int i, nblocks = CONFIG_ENV_RANGE / nand->erasesize;
+
+	for (i = envlog.valid; i < nblocks; i++) {
+		off += nand->erasesize;
+		if (off >= end)
+			off = start;
+		if (nand_block_isbad(nand, off))
+			continue;
+
+		printf("Writing to %s at 0x%llx... ", env_name_spec,
+		       (unsigned long long)off);
+		memcpy(env_log_data(), env_new, len);
+		if (nand_erase(nand, off, nand->erasesize) ||
+		    env_log_write(off, ENV_LOG_SNAPSHOT, len)) {
+			puts("FAILED!\n");
+			continue;
+		}
+		puts("OK\n");
+
+		envlog.valid = 1;
+		envlog.block = off;
+		envlog.next = off + env_log_rec_len(len);
+		return 0;
+	}
+
+	return 1;
+}
+
+int saveenv(void)
+{
+	loff_t end = envlog.block + nand_info[0].erasesize;
+	char *env_new = NULL;
+	size_t len;
+	int ret;
+
+	/* env_relocate_spec() could not set up */
+	if (!envlog.rec)
+		return 1;
+
+	if (hexport_r(&env_htab, '\0', 0, &env_new, ENV_SIZE, 0, NULL) < 0) {
+		error("Cannot export environment: errno = %d\n", errno);
+		return 1;
+	}
+
+	if (envlog.valid) {
+		len = env_log_diff(envlog.image, env_new, env_log_data(),
+				   ENV_SIZE);
+		if (!len) {
+			puts("Environment unchanged, not saving\n");
+			ret = 0;
+			goto done;
+		}
+
+		if (len <= ENV_SIZE &&
+		    envlog.next + env_log_rec_len(len) <= end) {
+			printf("Appending to %s... ", env_name_spec);
+			ret = env_log_write(envlog.next, ENV_LOG_DELTA, len);
+			puts(ret ? "FAILED!\n" : "OK\n");
+			if (!ret) {
+				envlog.next += env_log_rec_len(len);
+				goto saved;
+			}
+			/* Whatever got programmed there cannot be reused */
+			envlog.next = end;
+		}
+	}
+
+	/* The block is full, or there is none yet */
+	ret = env_log_compact(env_new);
+	if (ret)
+		goto done;
+
+saved:
+	memcpy(envlog.image, env_new, ENV_SIZE);
+done:
+	free(env_new);
+
+	return ret;
+}
+#endif /* CONFIG_CMD_SAVEENV */
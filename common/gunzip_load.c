@@ -0,0 +1,163 @@
+/*
+ * Inflate a gzipped kernel while it is loaded
+ *
+ * bootm only starts inflating a compressed kernel once all of it has been
+ * read. When the load command is going to boot the image straight away
+ * ("autostart" set to "yes": nboot, tftpboot, dhcp and the like), there is
+ * no reason to wait: the loaders already hand each piece of the file over
+ * as it arrives, through the hooks of CONFIG_HASH_ON_LOAD. For a gzipped
+ * legacy kernel image that data goes through the streaming gunzip straight
+ * to the load address of the image, so inflating overlaps with the reads;
+ * with NAND cache reads, the chip fetches the next page while the last one
+ * is inflated. bootm then only checks that the result is for the image it
+ * is booting.
+ *
+ * This is for legacy images only. In a FIT the compression and the load
+ * address of an image come after its data, so they are not known in time.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <bootstage.h>
+#include <image.h>
+#include <asm/io.h>
+
+#ifndef CONFIG_HASH_ON_LOAD
+#error "CONFIG_GUNZIP_ON_LOAD needs the loader hooks of CONFIG_HASH_ON_LOAD"
+#endif
+
+enum gunzip_load_state {
+	GUNZIP_LOAD_IDLE,	/* nothing to do until the next load */
+	GUNZIP_LOAD_HEADER,	/* waiting for the image header */
+	GUNZIP_LOAD_INFLATE,	/* inflating the image data */
+	GUNZIP_LOAD_DONE,	/* all of it inflated */
+};
+
+static struct {
+	enum gunzip_load_state state;
+	const uint8_t *base;	/* where the file is loaded */
+	ulong pos;		/* bytes of the file seen so far */
+	ulong fed;		/* bytes passed to inflate, header included */
+	ulong data_end;		/* end of the image data in the file */
+	void *dst;		/* load address of the image */
+	unsigned long size;	/* inflated size, once done */
+	int complete;		/* gunzip_load_end() was called */
+	struct gunzip_stream *gs;
+} gl;
+
+static void gunzip_load_stop(void)
+{
+	if (gl.state == GUNZIP_LOAD_INFLATE)
+		gunzip_stream_finish(gl.gs, NULL);
+	gl.state = GUNZIP_LOAD_IDLE;
+}
+
+void gunzip_load_start(void *buf)
+{
+	const char *ep = getenv("autostart");
+
+	gunzip_load_stop();
+	gl.base = buf;
+	gl.pos = 0;
+	gl.complete = 0;
+	/* Only when bootm is about to write to the load address anyway */
+	if (buf && ep && !strcmp(ep, "yes"))
+		gl.state = GUNZIP_LOAD_HEADER;
+}
+
+/* Set up the stream once the header is in; returns 0 if not to inflate */
+static int gunzip_load_header(void)
+{
+	const image_header_t *hdr = (const image_header_t *)gl.base;
+	ulong load, start = map_to_sysmem(gl.base);
+
+	if (!image_check_magic(hdr) || !image_check_hcrc(hdr) ||
+	    !image_check_type(hdr, IH_TYPE_KERNEL) ||
+	    image_get_comp(hdr) != IH_COMP_GZIP)
+		return 0;
+
+	/* bootm refuses to inflate over the image it inflates from */
+	load = image_get_load(hdr);
+	if (load < start + image_get_image_size(hdr) &&
+	    load + CONFIG_SYS_BOOTM_LEN > start)
+		return 0;
+
+	gl.dst = map_sysmem(load, CONFIG_SYS_BOOTM_LEN);
+	gl.gs = gunzip_stream_start(gl.dst, CONFIG_SYS_BOOTM_LEN);
+	if (!gl.gs)
+		return 0;
+	gl.fed = image_get_header_size();
+	gl.data_end = image_get_image_size(hdr);
+	gl.state = GUNZIP_LOAD_INFLATE;
+
+	return 1;
+}
+
+void gunzip_load_data(const void *buf, ulong len)
+{
+	ulong end;
+
+	/* Only data that continues the file, as for hash_load_data() */
+	if (gl.state == GUNZIP_LOAD_IDLE || gl.state == GUNZIP_LOAD_DONE ||
+	    !len || buf != gl.base + gl.pos)
+		return;
+
+	gl.pos += len;
+	if (gl.state == GUNZIP_LOAD_HEADER) {
+		if (gl.pos < image_get_header_size())
+			return;
+		if (!gunzip_load_header()) {
+			gl.state = GUNZIP_LOAD_IDLE;
+			return;
+		}
+	}
+
+	end = min(gl.pos, gl.data_end);
+	if (end <= gl.fed)
+		return;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decompress");
+	if (gunzip_stream_feed(gl.gs, (unsigned char *)gl.base + gl.fed,
+			       end - gl.fed) < 0) {
+		gunzip_load_stop();
+	} else {
+		gl.fed = end;
+		if (gl.fed == gl.data_end) {
+			gl.state = GUNZIP_LOAD_DONE;
+			if (gunzip_stream_finish(gl.gs, &gl.size))
+				gl.state = GUNZIP_LOAD_IDLE;
+		}
+	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
+}
+
+void gunzip_load_end(void *buf, ulong len)
+{
+	if (!buf || buf != gl.base)
+		return;
+
+	if (len > gl.pos)
+		gunzip_load_data(gl.base + gl.pos, len - gl.pos);
+
+	if (gl.state != GUNZIP_LOAD_DONE)
+		gunzip_load_stop();
+	gl.complete = 1;
+}
+
+int gunzip_load_lookup(const void *image_buf, ulong image_len,
+		       const void *load_buf, ulong unc_len, ulong *size)
+{
+	if (!gl.complete || gl.state != GUNZIP_LOAD_DONE ||
+	    image_buf != gl.base + image_get_header_size() ||
+	    image_len != gl.data_end - image_get_header_size() ||
+	    load_buf != gl.dst || unc_len != CONFIG_SYS_BOOTM_LEN)
+		return -ENOENT;
+
+	/* bootm may go on to write over it, so it is only good once */
+	gl.complete = 0;
+	*size = gl.size;
+
+	return 0;
+}
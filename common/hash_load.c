@@ -0,0 +1,318 @@
+/*
+ * Hash FIT images while they are loaded
+ *
+ * Checking a FIT normally costs a second pass over the image: the loader
+ * copies it into memory and fit_image_verify() then reads it all back to
+ * hash each image. Here the loaders hand each piece of the file over as
+ * soon as it is in memory, usually while it is still in the data cache.
+ * A small parser follows the flattened tree as it arrives and hashes every
+ * large property of the nodes under /images with CONFIG_HASH_ON_LOAD_ALGO.
+ * fit_image_check_hash() uses such a digest when it covers exactly the data
+ * it is about to check, so it does not matter which property it was.
+ *
+ * Property names are at the end of the tree, so they are not known while
+ * the data streams in; that is why every large property is hashed.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <bootstage.h>
+#include <hash.h>
+#include <image.h>
+#include <libfdt.h>
+
+#ifndef CONFIG_HASH_ON_LOAD_ALGO
+#define CONFIG_HASH_ON_LOAD_ALGO	"sha1"
+#endif
+
+/* Digests kept per load, and the smallest property worth hashing */
+#define HASH_LOAD_MAX_ENTRIES	8
+#define HASH_LOAD_MIN_SIZE	1024
+
+enum hash_load_state {
+	HASH_LOAD_IDLE,		/* nothing to do until the next load */
+	HASH_LOAD_HEADER,	/* waiting for the FDT header */
+	HASH_LOAD_TAGS,		/* walking the structure block */
+	HASH_LOAD_PROP,		/* hashing a property value */
+};
+
+struct hash_load_entry {
+	ulong offset;		/* of the property value in the file */
+	ulong len;
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+};
+
+static struct hash_load {
+	enum hash_load_state state;
+	const uint8_t *base;	/* where the file is loaded */
+	ulong pos;		/* bytes of the file seen so far */
+	ulong tag;		/* offset of the next tag */
+	ulong struct_end;	/* end of the structure block */
+	int depth;		/* nodes open before the next tag */
+	int in_images;		/* inside /images */
+	int complete;		/* hash_load_end() was called */
+
+	struct hash_algo *algo;
+	void *ctx;
+	ulong prop_start;	/* property value being hashed */
+	ulong prop_pos;
+	ulong prop_end;
+
+	int count;
+	struct hash_load_entry entry[HASH_LOAD_MAX_ENTRIES];
+} hl;
+
+static void hash_load_stop(void)
+{
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+
+	/* hash_finish() is what frees the context */
+	if (hl.state == HASH_LOAD_PROP)
+		hl.algo->hash_finish(hl.algo, hl.ctx, digest, sizeof(digest));
+	hl.state = HASH_LOAD_IDLE;
+}
+
+/*
+ * Commands that leave memory alone. Any other one might write over a loaded
+ * FIT (a load to the same address, 'sf read', 'fdt set', a standalone
+ * program), so running it drops the digests. The load commands drop them
+ * too, and then start over with the file they load. bootm is let through so
+ * it can use them to check the images; it drops them itself before it moves
+ * or decompresses anything.
+ */
+static const char *const hash_load_keep[] = {
+	"bootm", "echo", "iminfo", "printenv", "run", "setenv", "test",
+};
+
+void hash_load_command(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hash_load_keep); i++) {
+		if (!strcmp(name, hash_load_keep[i]))
+			return;
+	}
+	hash_load_start(NULL);
+}
+
+void hash_load_drop(void)
+{
+	hash_load_stop();
+	hl.complete = 0;
+}
+
+void hash_load_start(void *buf)
+{
+	gunzip_load_start(buf);
+	hash_load_stop();
+	hl.base = buf;
+	hl.pos = 0;
+	hl.depth = 0;
+	hl.in_images = 0;
+	hl.complete = 0;
+	hl.count = 0;
+	if (buf &&
+	    !hash_progressive_lookup_algo(CONFIG_HASH_ON_LOAD_ALGO, &hl.algo))
+		hl.state = HASH_LOAD_HEADER;
+}
+
+/* Check the header once it is in; returns 0 if this is not a tree */
+static int hash_load_header(void)
+{
+	const void *fdt = hl.base;
+
+	if (hl.pos < sizeof(struct fdt_header))
+		return 0;
+	if (fdt_magic(fdt) != FDT_MAGIC) {
+		hl.state = HASH_LOAD_IDLE;
+		return 0;
+	}
+
+	hl.tag = fdt_off_dt_struct(fdt);
+	if (fdt_version(fdt) >= 17)
+		hl.struct_end = hl.tag + fdt_size_dt_struct(fdt);
+	else
+		hl.struct_end = fdt_totalsize(fdt);
+	if (hl.struct_end < hl.tag || hl.struct_end > fdt_totalsize(fdt)) {
+		hl.state = HASH_LOAD_IDLE;
+		return 0;
+	}
+	hl.state = HASH_LOAD_TAGS;
+
+	return 1;
+}
+
+/* Hash what has arrived of the property; returns 0 if it needs more data */
+static int hash_load_prop(void)
+{
+	struct hash_load_entry *ent;
+	ulong end = min(hl.pos, hl.prop_end);
+	uint32_t crc;
+
+	if (end > hl.prop_pos) {
+		if (hl.algo->hash_update(hl.algo, hl.ctx,
+					 hl.base + hl.prop_pos,
+					 end - hl.prop_pos, end == hl.prop_end)) {
+			/* The context is gone already */
+			hl.state = HASH_LOAD_IDLE;
+			return 0;
+		}
+		hl.prop_pos = end;
+	}
+	if (hl.prop_pos < hl.prop_end)
+		return 0;
+
+	hl.state = HASH_LOAD_TAGS;
+	ent = &hl.entry[hl.count];
+	if (hl.algo->hash_finish(hl.algo, hl.ctx, ent->digest,
+				 sizeof(ent->digest)))
+		return 1;
+
+	/* calculate_hash() stores a CRC32 as a uImage does */
+	if (!strcmp(hl.algo->name, "crc32")) {
+		memcpy(&crc, ent->digest, sizeof(crc));
+		crc = cpu_to_uimage(crc);
+		memcpy(ent->digest, &crc, sizeof(crc));
+	}
+	ent->offset = hl.prop_start;
+	ent->len = hl.prop_end - hl.prop_start;
+	hl.count++;
+
+	return 1;
+}
+
+/* Parse the next tag; returns 0 if it needs more data or the walk is over */
+static int hash_load_tag(void)
+{
+	const fdt32_t *p = (const fdt32_t *)(hl.base + hl.tag);
+	const char *name, *nul;
+	ulong len;
+
+	if (hl.tag >= hl.struct_end) {
+		hl.state = HASH_LOAD_IDLE;
+		return 0;
+	}
+	if (hl.tag + FDT_TAGSIZE > hl.pos)
+		return 0;
+
+	switch (fdt32_to_cpu(p[0])) {
+	case FDT_BEGIN_NODE:
+		name = (const char *)(p + 1);
+		nul = memchr(name, '\0',
+			     hl.base + hl.pos - (const uint8_t *)name);
+		if (!nul)
+			return 0;
+		len = FDT_TAGSIZE + ALIGN(nul - name + 1, FDT_TAGSIZE);
+		if (len > hl.struct_end - hl.tag) {
+			hl.state = HASH_LOAD_IDLE;
+			return 0;
+		}
+		if (++hl.depth == 2 && !strcmp(name, FIT_IMAGES_PATH + 1))
+			hl.in_images = 1;
+		hl.tag += len;
+		break;
+	case FDT_END_NODE:
+		if (hl.depth-- == 2)
+			hl.in_images = 0;
+		hl.tag += FDT_TAGSIZE;
+		break;
+	case FDT_PROP:
+		if (hl.tag + sizeof(struct fdt_property) > hl.pos)
+			return 0;
+		len = fdt32_to_cpu(p[1]);
+		hl.tag += sizeof(struct fdt_property);
+		/* A bogus length must not wrap the walk back onto this tag */
+		if (hl.tag > hl.struct_end || len > hl.struct_end - hl.tag) {
+			hl.state = HASH_LOAD_IDLE;
+			return 0;
+		}
+		/* Properties of an image node, not of its hash subnodes */
+		if (hl.in_images && hl.depth == 3 &&
+		    len >= HASH_LOAD_MIN_SIZE &&
+		    hl.count < HASH_LOAD_MAX_ENTRIES &&
+		    !hl.algo->hash_init(hl.algo, &hl.ctx)) {
+			hl.prop_start = hl.tag;
+			hl.prop_pos = hl.tag;
+			hl.prop_end = hl.tag + len;
+			hl.state = HASH_LOAD_PROP;
+		}
+		hl.tag += ALIGN(len, FDT_TAGSIZE);
+		break;
+	case FDT_NOP:
+		hl.tag += FDT_TAGSIZE;
+		break;
+	default:
+		/* FDT_END, or not a tree we understand */
+		hl.state = HASH_LOAD_IDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+void hash_load_data(const void *buf, ulong len)
+{
+	const uint8_t *p = buf;
+
+	gunzip_load_data(buf, len);
+	if (hl.state == HASH_LOAD_IDLE || !len)
+		return;
+
+	/*
+	 * Only take data that continues the file. Anything else is either
+	 * a read for some other purpose, a block we have seen before (TFTP
+	 * retransmits) or a piece that a loader did not report; in the last
+	 * case hash_load_end() picks up the rest from memory.
+	 */
+	if (p != hl.base + hl.pos)
+		return;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_HASH_LOAD, "hash_load");
+	hl.pos += len;
+	if (hl.state == HASH_LOAD_HEADER && !hash_load_header())
+		goto out;
+
+	for (;;) {
+		if (hl.state == HASH_LOAD_PROP && !hash_load_prop())
+			break;
+		if (hl.state != HASH_LOAD_TAGS || !hash_load_tag())
+			break;
+	}
+out:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_HASH_LOAD);
+}
+
+void hash_load_end(void *buf, ulong len)
+{
+	gunzip_load_end(buf, len);
+	if (!buf || buf != hl.base)
+		return;
+
+	if (len > hl.pos)
+		hash_load_data(hl.base + hl.pos, len - hl.pos);
+
+	/* A property cut short by the end of the file is no use */
+	hash_load_stop();
+	hl.complete = 1;
+}
+
+int hash_load_lookup(const void *data, ulong len, const char *algo_name,
+		     uint8_t *value, int *value_len)
+{
+	struct hash_load_entry *ent;
+
+	if (!hl.complete || !hl.count || strcmp(algo_name, hl.algo->name))
+		return -ENOENT;
+
+	for (ent = hl.entry; ent < hl.entry + hl.count; ent++) {
+		if (hl.base + ent->offset == data && ent->len == len) {
+			memcpy(value, ent->digest, hl.algo->digest_size);
+			*value_len = hl.algo->digest_size;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
@@ -902,6 +902,16 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp)
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len)
 {
+#if defined(CONFIG_SHA_HW_ACCEL) && !defined(USE_HOSTCC)
+	struct hash_algo *hash;
+
+	/* Let the crypto engine do the SHA sums, see hash_algo[] */
+	if (!strncmp(algo, "sha", 3) && !hash_lookup_algo(algo, &hash)) {
+		hash->hash_func_ws(data, data_len, value, hash->chunk_size);
+		*value_len = hash->digest_size;
+		return 0;
+	}
+#endif
 	if (IMAGE_ENABLE_CRC32 && strcmp(algo, "crc32") == 0) {
 		*((uint32_t *)value) = crc32_wd(0, data, data_len,
 							CHUNKSZ_CRC32);
@@ -925,6 +935,29 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 	return 0;
 }
 
+/*
+ * Hash the data of an image for fit_image_check_hash(), unless that was
+ * done while the FIT was loaded (CONFIG_HASH_ON_LOAD)
+ */
+static int fit_image_hash_data(const void *data, size_t size, char *algo,
+			       uint8_t *value, int *value_len)
+{
+#ifndef USE_HOSTCC
+	int ret;
+
+	if (!hash_load_lookup(data, size, algo, value, value_len))
+		return 0;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FIT_HASH, "fit_hash");
+	ret = calculate_hash(data, size, algo, value, value_len);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FIT_HASH);
+
+	return ret;
+#else
+	return calculate_hash(data, size, algo, value, value_len);
+#endif
+}
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 				size_t size, char **err_msgp)
 {
@@ -957,7 +990,7 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (fit_image_hash_data(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
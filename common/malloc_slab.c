@@ -0,0 +1,282 @@
+/*
+ * Size-class front end for malloc()
+ *
+ * Most of what U-Boot allocates is small: UBIFS znodes and LPT nodes, USB
+ * transfer descriptors, driver model devices. dlmalloc serves each of them
+ * from its bins, with a header per chunk and a search that gets longer as
+ * the heap fragments in a long 'ums' or 'dfu' session. Here requests of up
+ * to SLAB_MAX bytes are instead rounded up to one of a few size classes
+ * and served from pages that only hold objects of that class, so that
+ * allocating and freeing is a list operation and small objects do not
+ * break up the main heap.
+ *
+ * The pages come from an arena of CONFIG_SYS_MALLOC_SLAB_SIZE bytes which
+ * is taken from dlmalloc on first use. A class gets a page when it needs
+ * one and gives it back once all its objects are freed. Larger requests,
+ * those that need more than SLAB_ALIGN alignment and those that find the
+ * arena full go to dlmalloc as before; free() and realloc() tell the two
+ * apart by the address.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/list.h>
+
+#ifdef CONFIG_SYS_MALLOC_SIMPLE
+#error "CONFIG_SYS_MALLOC_SLAB needs the full malloc()"
+#endif
+
+#ifndef CONFIG_SYS_MALLOC_SLAB_SIZE
+#define CONFIG_SYS_MALLOC_SLAB_SIZE	(256 << 10)
+#endif
+
+#define SLAB_PAGE_SIZE		4096
+#define SLAB_PAGES		(CONFIG_SYS_MALLOC_SLAB_SIZE / SLAB_PAGE_SIZE)
+#define SLAB_ARENA_SIZE		(SLAB_PAGES * SLAB_PAGE_SIZE)
+/* Every class is a multiple of this, so every object is aligned to it */
+#define SLAB_ALIGN		16
+#define SLAB_MAX		256
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static const unsigned short slab_size[] = {
+	16, 32, 48, 64, 96, 128, 192, 256
+};
+
+#define SLAB_CLASSES		ARRAY_SIZE(slab_size)
+
+/* Class for a request, by the request rounded up to SLAB_ALIGN */
+static const unsigned char slab_index[SLAB_MAX / SLAB_ALIGN + 1] = {
+	0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+};
+
+struct slab_page {
+	struct list_head list;	/* on its class's list, or free */
+	void *free;		/* freed objects, linked through their start */
+	unsigned short bump;	/* offset of the first object never used */
+	unsigned short inuse;
+	unsigned char cls;
+};
+
+struct slab_class {
+	struct list_head partial;	/* pages that have room */
+	ulong live;			/* objects handed out */
+	ulong peak;
+	ulong fail;			/* passed on as the arena was full */
+	uint pages;
+};
+
+static struct {
+	char *arena;		/* NULL until first used */
+	int disabled;		/* dlmalloc could not give us one */
+	struct list_head free_pages;
+	uint nfree;
+	struct slab_class cls[SLAB_CLASSES];
+	struct slab_page page[SLAB_PAGES];
+} slab;
+
+/* Before relocation everything goes to malloc_simple() */
+static inline int slab_early(void)
+{
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	if (gd && !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 1;
+#endif
+	return 0;
+}
+
+static int slab_ready(void)
+{
+	int i;
+
+	if (slab_early())
+		return 0;
+	if (slab.arena)
+		return 1;
+	if (slab.disabled || !mem_malloc_start)
+		return 0;
+
+	slab.arena = dlmemalign(SLAB_PAGE_SIZE, SLAB_ARENA_SIZE);
+	if (!slab.arena) {
+		slab.disabled = 1;
+		return 0;
+	}
+
+	INIT_LIST_HEAD(&slab.free_pages);
+	for (i = 0; i < SLAB_PAGES; i++)
+		list_add_tail(&slab.page[i].list, &slab.free_pages);
+	slab.nfree = SLAB_PAGES;
+	for (i = 0; i < SLAB_CLASSES; i++)
+		INIT_LIST_HEAD(&slab.cls[i].partial);
+
+	return 1;
+}
+
+static inline int slab_owns(const void *mem)
+{
+	return !slab_early() && slab.arena &&
+		(ulong)mem - (ulong)slab.arena < SLAB_ARENA_SIZE;
+}
+
+static inline struct slab_page *slab_page_of(const void *mem)
+{
+	return &slab.page[((ulong)mem - (ulong)slab.arena) / SLAB_PAGE_SIZE];
+}
+
+static inline int slab_page_full(const struct slab_page *pg)
+{
+	return !pg->free && pg->bump + slab_size[pg->cls] > SLAB_PAGE_SIZE;
+}
+
+/* Returns NULL if the request is not one for the slab, or it is full */
+static void *slab_malloc(size_t bytes)
+{
+	struct slab_class *sc;
+	struct slab_page *pg;
+	void *obj;
+	int cls;
+
+	if (bytes > SLAB_MAX || !slab_ready())
+		return NULL;
+
+	cls = slab_index[(bytes + SLAB_ALIGN - 1) / SLAB_ALIGN];
+	sc = &slab.cls[cls];
+	if (list_empty(&sc->partial)) {
+		if (list_empty(&slab.free_pages)) {
+			sc->fail++;
+			return NULL;
+		}
+		pg = list_first_entry(&slab.free_pages, struct slab_page,
+				      list);
+		list_move(&pg->list, &sc->partial);
+		slab.nfree--;
+		pg->free = NULL;
+		pg->bump = 0;
+		pg->inuse = 0;
+		pg->cls = cls;
+		sc->pages++;
+	}
+
+	pg = list_first_entry(&sc->partial, struct slab_page, list);
+	if (pg->free) {
+		obj = pg->free;
+		pg->free = *(void **)obj;
+	} else {
+		obj = slab.arena + (pg - slab.page) * SLAB_PAGE_SIZE + pg->bump;
+		pg->bump += slab_size[cls];
+	}
+	pg->inuse++;
+	/* Off the list until something in it is freed */
+	if (slab_page_full(pg))
+		list_del(&pg->list);
+
+	if (++sc->live > sc->peak)
+		sc->peak = sc->live;
+
+	return obj;
+}
+
+static void slab_free(void *mem)
+{
+	struct slab_page *pg = slab_page_of(mem);
+	struct slab_class *sc = &slab.cls[pg->cls];
+	int was_full = slab_page_full(pg);
+
+	*(void **)mem = pg->free;
+	pg->free = mem;
+	pg->inuse--;
+	sc->live--;
+
+	if (was_full) {
+		list_add(&pg->list, &sc->partial);
+	} else if (!pg->inuse && !list_is_singular(&sc->partial)) {
+		/* Keep the last page, or a lone object would churn pages */
+		list_move(&pg->list, &slab.free_pages);
+		slab.nfree++;
+		sc->pages--;
+	}
+}
+
+void *slmalloc(size_t bytes)
+{
+	void *mem = slab_malloc(bytes);
+
+	return mem ? mem : dlmalloc(bytes);
+}
+
+void slfree(void *mem)
+{
+	if (slab_owns(mem))
+		slab_free(mem);
+	else
+		dlfree(mem);
+}
+
+void *slrealloc(void *mem, size_t bytes)
+{
+	size_t size;
+	void *new;
+
+	if (!mem)
+		return slmalloc(bytes);
+	if (!slab_owns(mem))
+		return dlrealloc(mem, bytes);
+
+	size = slab_size[slab_page_of(mem)->cls];
+	if (bytes <= size)
+		return mem;
+
+	new = slmalloc(bytes);
+	if (new) {
+		memcpy(new, mem, size);
+		slab_free(mem);
+	}
+
+	return new;
+}
+
+void *slmemalign(size_t alignment, size_t bytes)
+{
+	void *mem = NULL;
+
+	if (alignment <= SLAB_ALIGN)
+		mem = slab_malloc(bytes);
+
+	return mem ? mem : dlmemalign(alignment, bytes);
+}
+
+void *slcalloc(size_t n, size_t elem_size)
+{
+	size_t bytes = n * elem_size;
+	void *mem = NULL;
+
+	if (!elem_size || bytes / elem_size == n)
+		mem = slab_malloc(bytes);
+	if (!mem)
+		return dlcalloc(n, elem_size);
+	memset(mem, '\0', bytes);
+
+	return mem;
+}
+
+void malloc_slab_stats(void)
+{
+	struct slab_class *sc;
+	int i;
+
+	if (!slab.arena) {
+		puts("Slab arena not in use\n");
+		return;
+	}
+
+	printf("Slab arena at %p, %u of %u pages of %u bytes free\n",
+	       slab.arena, slab.nfree, SLAB_PAGES, SLAB_PAGE_SIZE);
+	puts(" size      live      peak  failures  pages\n");
+	for (i = 0; i < SLAB_CLASSES; i++) {
+		sc = &slab.cls[i];
+		printf("%5u %9lu %9lu %9lu %6u\n", slab_size[i], sc->live,
+		       sc->peak, sc->fail, sc->pages);
+	}
+}
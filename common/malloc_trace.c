@@ -0,0 +1,154 @@
+/*
+ * Record who calls malloc() and free()
+ *
+ * Every call is logged with the address it was made from, the block, the
+ * size asked for and a timestamp, in a ring of CONFIG_TRACE_HEAP_RECORDS
+ * records of which the oldest are overwritten once it is full. Recording
+ * starts at relocation, when the full malloc() comes up. 'malloc trace'
+ * writes the ring out like 'trace calls' does, as a TRACE_CHUNK_HEAP
+ * chunk, and 'proftool dump-heap' turns that into the peak and leaked
+ * memory of each call site.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <trace.h>
+#include <asm/sections.h>
+
+#ifndef CONFIG_TRACE_HEAP_RECORDS
+#define CONFIG_TRACE_HEAP_RECORDS	8192
+#endif
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static struct {
+	ulong count;		/* records written, overwritten ones too */
+	struct trace_heap rec[CONFIG_TRACE_HEAP_RECORDS];
+} heap_trace;
+
+static inline uint32_t heap_code_offset(void *pc)
+{
+	uintptr_t offset = (uintptr_t)pc;
+
+#ifdef CONFIG_SANDBOX
+	offset -= (uintptr_t)&_init;
+#else
+	offset -= gd->relocaddr;
+#endif
+	return offset;
+}
+
+static void heap_record(uint32_t type, void *caller, void *ptr, size_t size)
+{
+	struct trace_heap *rec;
+
+	/* The ring is in BSS, which is not there before relocation */
+	if (!ptr || !gd || !(gd->flags & GD_FLG_RELOC))
+		return;
+
+	rec = &heap_trace.rec[heap_trace.count++ % CONFIG_TRACE_HEAP_RECORDS];
+	rec->caller = heap_code_offset(caller);
+	rec->ptr = (ulong)ptr - mem_malloc_start;
+	rec->size = size;
+	rec->flags = type | (timer_get_us() & HEAPF_TIMESTAMP_MASK);
+}
+
+void *malloc(size_t bytes)
+{
+	void *mem = slmalloc(bytes);
+
+	heap_record(HEAPF_MALLOC, __builtin_return_address(0), mem, bytes);
+
+	return mem;
+}
+
+void free(void *mem)
+{
+	heap_record(HEAPF_FREE, __builtin_return_address(0), mem, 0);
+	slfree(mem);
+}
+
+void *realloc(void *mem, size_t bytes)
+{
+	void *new = slrealloc(mem, bytes);
+
+	/* A move, as far as the trace goes; a failure changes nothing */
+	if (new) {
+		heap_record(HEAPF_FREE, __builtin_return_address(0), mem, 0);
+		heap_record(HEAPF_MALLOC, __builtin_return_address(0), new,
+			    bytes);
+	}
+
+	return new;
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	void *mem = slmemalign(alignment, bytes);
+
+	heap_record(HEAPF_MEMALIGN, __builtin_return_address(0), mem, bytes);
+
+	return mem;
+}
+
+void *calloc(size_t n, size_t elem_size)
+{
+	void *mem = slcalloc(n, elem_size);
+
+	heap_record(HEAPF_MALLOC, __builtin_return_address(0), mem,
+		    n * elem_size);
+
+	return mem;
+}
+
+int trace_list_heap(void *buff, int buff_size, unsigned int *needed)
+{
+	struct trace_output_hdr *output_hdr = NULL;
+	void *end, *ptr = buff;
+	ulong rec, first;
+	int upto;
+
+	end = buff ? buff + buff_size : NULL;
+
+	/* Place some header information */
+	if (ptr + sizeof(struct trace_output_hdr) <= end)
+		output_hdr = ptr;
+	ptr += sizeof(struct trace_output_hdr);
+
+	/* Add the records that are left, oldest first */
+	first = 0;
+	if (heap_trace.count > CONFIG_TRACE_HEAP_RECORDS)
+		first = heap_trace.count - CONFIG_TRACE_HEAP_RECORDS;
+	for (rec = first, upto = 0; rec < heap_trace.count; rec++) {
+		if (ptr + sizeof(struct trace_heap) <= end) {
+			struct trace_heap *out = ptr;
+
+			*out = heap_trace.rec[rec % CONFIG_TRACE_HEAP_RECORDS];
+			upto++;
+		}
+		ptr += sizeof(struct trace_heap);
+	}
+
+	/* Update the header */
+	if (output_hdr) {
+		output_hdr->rec_count = upto;
+		output_hdr->type = TRACE_CHUNK_HEAP;
+	}
+
+	/* Work out how much of the buffer we used */
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -1;
+	return 0;
+}
+
+void trace_heap_stats(void)
+{
+	printf("Heap trace: %lu calls recorded", heap_trace.count);
+	if (heap_trace.count > CONFIG_TRACE_HEAP_RECORDS)
+		printf(", oldest %lu overwritten",
+		       heap_trace.count - CONFIG_TRACE_HEAP_RECORDS);
+	puts("\n");
+}
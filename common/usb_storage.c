@@ -33,6 +33,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <fat.h>
 #include <inttypes.h>
 #include <asm/byteorder.h>
 #include <asm/processor.h>
@@ -223,6 +224,8 @@ int usb_stor_scan(int mode)
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 
+	/* The devices found may not be the ones there were before */
+	fat_invalidate();
 	for (i = 0; i < USB_MAX_STOR_DEV; i++) {
 		memset(&usb_dev_desc[i], 0, sizeof(block_dev_desc_t));
 		usb_dev_desc[i].if_type = IF_TYPE_USB;
@@ -1125,6 +1128,8 @@ unsigned long usb_stor_write(int device, lbaint_t blknr,
 	if (blkcnt == 0)
 		return 0;
 
+	/* The blocks may belong to the mounted FAT volume */
+	fat_invalidate();
 	device &= 0xff;
 	/* Setup  device */
 	debug("\nusb_write: dev %d \n", device);
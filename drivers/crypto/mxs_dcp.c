@@ -0,0 +1,483 @@
+/*
+ * Freescale i.MX23/i.MX28 Data Co-Processor (DCP) driver
+ *
+ * The DCP computes SHA-1/SHA-256 and AES-128-CBC from memory by DMA. It
+ * backs the "sha1"/"sha256" entries of hash_algo[] (CONFIG_SHA_HW_ACCEL,
+ * CONFIG_SHA_PROG_HW_ACCEL) and aes_cbc_{en,de}crypt_blocks()
+ * (CONFIG_AES_HW_ACCEL). If the block is missing or fails, the software
+ * implementations are used instead.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <aes.h>
+#include <hw_sha.h>
+#include <asm/io.h>
+#include <asm/errno.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#ifndef CONFIG_MXS_DCP_SANDBOX
+#include <asm/arch/imx-regs.h>
+#include <asm/arch/sys_proto.h>
+#endif
+#include "mxs_dcp.h"
+
+#define DCP_CHAN_AES		0
+#define DCP_CHAN_SHA		1	/* progressive hashing */
+#define DCP_CHAN_SHA_ONESHOT	2
+
+#define DCP_TIMEOUT_US		1000000
+#define DCP_CONTEXT_SIZE	(DCP_CHANNELS * 256)
+#define DCP_AES_BUF_SIZE	2048
+
+#ifdef CONFIG_MXS_DCP_SANDBOX
+#define dcp_readl(addr)		(*(volatile u32 *)(addr))
+#define dcp_writel(val, addr)	(*(volatile u32 *)(addr) = (val))
+#define dcp_addr(ptr)		((u32)map_to_sysmem(ptr))
+#else
+#define dcp_readl		readl
+#define dcp_writel		writel
+#define dcp_addr(ptr)		((u32)(ptr))
+#endif
+
+/* Everything the engine reads or writes besides the data itself */
+struct dcp_dma {
+	struct dcp_desc desc[DCP_CHANNELS] __aligned(ARCH_DMA_MINALIGN);
+	u8 context[DCP_CONTEXT_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 digest[SHA256_SUM_LEN] __aligned(ARCH_DMA_MINALIGN);
+	u8 aes_key[2 * AES_KEY_LENGTH] __aligned(ARCH_DMA_MINALIGN);
+	u8 aes_in[DCP_AES_BUF_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 aes_out[DCP_AES_BUF_SIZE] __aligned(ARCH_DMA_MINALIGN);
+};
+
+/* Progressive hashing context, see hw_sha_init() */
+struct dcp_sha_ctx {
+	u8 tail[DCP_SHA_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 digest[SHA256_SUM_LEN] __aligned(ARCH_DMA_MINALIGN);
+	unsigned int tail_len;	/* bytes held back in tail */
+	int sha256;
+	int started;		/* HASH_INIT sent */
+	int done;		/* HASH_TERM sent, digest valid */
+	int sw;			/* hashed in software */
+	union {
+		sha1_context sha1;
+		sha256_context sha256;
+	} sw_ctx;
+};
+
+static struct mxs_dcp_regs *dcp_regs;
+static struct dcp_dma *dcp;
+static u32 dcp_caps;
+static int dcp_absent;
+/* Only one progressive hash can own DCP_CHAN_SHA at a time */
+static struct dcp_sha_ctx *dcp_sha_owner;
+
+static int dcp_reset(void)
+{
+#ifdef CONFIG_MXS_DCP_SANDBOX
+	dcp_writel(DCP_CTRL_SFTRST | DCP_CTRL_CLKGATE, &dcp_regs->ctrl_clr);
+	return 0;
+#else
+	return mxs_reset_block((struct mxs_register_32 *)&dcp_regs->ctrl);
+#endif
+}
+
+/*
+ * Bring the block up on first use. Returns 0 if it can do everything in
+ * @caps (DCP_CAPABILITY1_*), -ENODEV if the caller has to do it in software.
+ */
+static int dcp_probe(u32 caps)
+{
+	u32 ctrl;
+	int i;
+
+	if (dcp)
+		return (dcp_caps & caps) == caps ? 0 : -ENODEV;
+	if (dcp_absent)
+		return -ENODEV;
+
+#ifdef CONFIG_MXS_DCP_SANDBOX
+	dcp_regs = sandbox_dcp_regs();
+#else
+	dcp_regs = (struct mxs_dcp_regs *)MXS_DCP_BASE;
+#endif
+	dcp_absent = 1;
+	if (dcp_reset()) {
+		puts("DCP: reset failed\n");
+		return -ENODEV;
+	}
+
+	ctrl = dcp_readl(&dcp_regs->ctrl);
+	dcp_caps = dcp_readl(&dcp_regs->capability1);
+	if (!(ctrl & DCP_CTRL_PRESENT_SHA))
+		dcp_caps &= ~(DCP_CAPABILITY1_SHA1 | DCP_CAPABILITY1_SHA256);
+	if (!(ctrl & DCP_CTRL_PRESENT_CRYPTO))
+		dcp_caps &= ~DCP_CAPABILITY1_AES128;
+
+	dcp = memalign(ARCH_DMA_MINALIGN, sizeof(*dcp));
+	if (!dcp)
+		return -ENODEV;
+	memset(dcp, 0, sizeof(*dcp));
+	flush_dcache_range((ulong)dcp, (ulong)dcp + sizeof(*dcp));
+
+	/*
+	 * Progressive hashes on DCP_CHAN_SHA can be interleaved with work on
+	 * the other channels, so let the block save each channel's context.
+	 */
+	dcp_writel(DCP_CTRL_GATHER_RESIDUAL_WRITES |
+		   DCP_CTRL_ENABLE_CONTEXT_CACHING |
+		   DCP_CTRL_ENABLE_CONTEXT_SWITCHING, &dcp_regs->ctrl_set);
+	dcp_writel(dcp_addr(dcp->context), &dcp_regs->context);
+	dcp_writel(DCP_CHANNELCTRL_ENABLE_CHANNEL_MASK,
+		   &dcp_regs->channelctrl);
+	dcp_writel(DCP_STAT_IRQ_MASK, &dcp_regs->stat_clr);
+	for (i = 0; i < DCP_CHANNELS; i++)
+		dcp_writel(DCP_CH_STAT_ERROR_MASK, &dcp_regs->ch[i].stat_clr);
+
+	dcp_absent = 0;
+
+	return (dcp_caps & caps) == caps ? 0 : -ENODEV;
+}
+
+static void dcp_flush(const void *start, unsigned long len)
+{
+	ulong s = rounddown((ulong)start, ARCH_DMA_MINALIGN);
+	ulong e = roundup((ulong)start + len, ARCH_DMA_MINALIGN);
+
+	flush_dcache_range(s, e);
+}
+
+/* Only for buffers of our own, which are aligned on both ends */
+static void dcp_invalidate(const void *start, unsigned long len)
+{
+	invalidate_dcache_range((ulong)start,
+				(ulong)start + roundup(len, ARCH_DMA_MINALIGN));
+}
+
+/* Run the packet in dcp->desc[chan] and wait for it */
+static int dcp_run(int chan)
+{
+	struct dcp_desc *desc = &dcp->desc[chan];
+	uint timeout = DCP_TIMEOUT_US;
+	u32 stat;
+
+	desc->next = 0;
+	desc->control0 |= DCP_CONTROL0_DECR_SEMAPHORE;
+	desc->status = 0;
+	dcp_flush(desc, sizeof(*desc));
+
+	dcp_writel(dcp_addr(desc), &dcp_regs->ch[chan].cmdptr);
+	dcp_writel(1, &dcp_regs->ch[chan].sema);
+#ifdef CONFIG_MXS_DCP_SANDBOX
+	sandbox_dcp_run(chan);
+#endif
+
+	/* Stop waiting as soon as the channel reports an error */
+	while (dcp_readl(&dcp_regs->ch[chan].sema) & DCP_CH_SEMA_VALUE_MASK) {
+		if (dcp_readl(&dcp_regs->ch[chan].stat) &
+		    DCP_CH_STAT_ERROR_MASK)
+			break;
+		if (!--timeout) {
+			printf("DCP: channel %d timed out\n", chan);
+			return -ETIMEDOUT;
+		}
+		udelay(1);
+	}
+
+	dcp_writel(1 << chan, &dcp_regs->stat_clr);
+	stat = dcp_readl(&dcp_regs->ch[chan].stat) & DCP_CH_STAT_ERROR_MASK;
+	if (stat) {
+		printf("DCP: channel %d error 0x%08x\n", chan, stat);
+		dcp_writel(stat, &dcp_regs->ch[chan].stat_clr);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * Hash len bytes at buf on chan. The first packet of a message has init
+ * set; the last one passes digest, which receives the result in the order
+ * the engine writes it (reversed).
+ */
+static int dcp_sha_run(int chan, int sha256, const void *buf, u32 len,
+		       int init, u8 *digest)
+{
+	struct dcp_desc *desc = &dcp->desc[chan];
+
+	desc->control0 = DCP_CONTROL0_ENABLE_HASH;
+	if (init)
+		desc->control0 |= DCP_CONTROL0_HASH_INIT;
+	desc->control1 = sha256 ? DCP_CONTROL1_HASH_SELECT_SHA256 :
+				  DCP_CONTROL1_HASH_SELECT_SHA1;
+	desc->src = dcp_addr(buf);
+	desc->dst = 0;
+	desc->size = len;
+	desc->payload = 0;
+	if (digest) {
+		desc->control0 |= DCP_CONTROL0_HASH_TERM;
+		desc->payload = dcp_addr(digest);
+		dcp_flush(digest, SHA256_SUM_LEN);
+	}
+	dcp_flush(buf, len);
+
+	return dcp_run(chan);
+}
+
+static void dcp_sha_copy_digest(u8 *out, const u8 *digest, int len)
+{
+	int i;
+
+	dcp_invalidate(digest, SHA256_SUM_LEN);
+	for (i = 0; i < len; i++)
+		out[i] = digest[len - 1 - i];
+}
+
+/* Hash a whole buffer, chunk_size bytes per packet */
+static int dcp_sha(int sha256, const uchar *buf, uint len, uchar *out,
+		   uint chunk_size)
+{
+	u32 caps = sha256 ? DCP_CAPABILITY1_SHA256 : DCP_CAPABILITY1_SHA1;
+	uint chunk, off;
+	int ret;
+
+	/* The engine cannot hash an empty message */
+	if (!len || dcp_probe(caps))
+		return -ENODEV;
+
+	chunk = rounddown(max(chunk_size, (uint)DCP_SHA_BLOCK_SIZE),
+			  DCP_SHA_BLOCK_SIZE);
+	for (off = 0; off < len; off += chunk) {
+		chunk = min(chunk, len - off);
+		ret = dcp_sha_run(DCP_CHAN_SHA_ONESHOT, sha256, buf + off,
+				  chunk, !off,
+				  off + chunk == len ? dcp->digest : NULL);
+		if (ret)
+			return ret;
+		WATCHDOG_RESET();
+	}
+	dcp_sha_copy_digest(out, dcp->digest,
+			    sha256 ? SHA256_SUM_LEN : SHA1_SUM_LEN);
+
+	return 0;
+}
+
+void hw_sha1(const uchar *in_addr, uint buflen, uchar *out_addr,
+	     uint chunk_size)
+{
+	if (dcp_sha(0, in_addr, buflen, out_addr, chunk_size))
+		sha1_csum_wd(in_addr, buflen, out_addr, chunk_size);
+}
+
+void hw_sha256(const uchar *in_addr, uint buflen, uchar *out_addr,
+	       uint chunk_size)
+{
+	if (dcp_sha(1, in_addr, buflen, out_addr, chunk_size))
+		sha256_csum_wd(in_addr, buflen, out_addr, chunk_size);
+}
+
+#ifdef CONFIG_SHA_PROG_HW_ACCEL
+static void dcp_sha_ctx_free(struct dcp_sha_ctx *ctx)
+{
+	if (dcp_sha_owner == ctx)
+		dcp_sha_owner = NULL;
+	free(ctx);
+}
+
+int hw_sha_init(struct hash_algo *algo, void **ctxp)
+{
+	struct dcp_sha_ctx *ctx;
+	u32 caps;
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(*ctx));
+	if (!ctx)
+		return -ENOMEM;
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->sha256 = !strcmp(algo->name, "sha256");
+
+	caps = ctx->sha256 ? DCP_CAPABILITY1_SHA256 : DCP_CAPABILITY1_SHA1;
+	if (dcp_sha_owner || dcp_probe(caps)) {
+		ctx->sw = 1;
+		if (ctx->sha256)
+			sha256_starts(&ctx->sw_ctx.sha256);
+		else
+			sha1_starts(&ctx->sw_ctx.sha1);
+	} else {
+		dcp_sha_owner = ctx;
+	}
+	*ctxp = ctx;
+
+	return 0;
+}
+
+/* Send the held-back block, which ends the message if last is set */
+static int dcp_sha_send_tail(struct dcp_sha_ctx *ctx, int last)
+{
+	int ret;
+
+	ret = dcp_sha_run(DCP_CHAN_SHA, ctx->sha256, ctx->tail, ctx->tail_len,
+			  !ctx->started, last ? ctx->digest : NULL);
+	ctx->started = 1;
+	ctx->tail_len = 0;
+	ctx->done = last;
+
+	return ret;
+}
+
+/*
+ * All packets but the last must be whole blocks, and the last one must not
+ * be empty, so the final 1..64 bytes seen so far are always held back in
+ * ctx->tail until we know whether more data follows.
+ */
+int hw_sha_update(struct hash_algo *algo, void *hash_ctx, const void *buf,
+		  unsigned int size, int is_last)
+{
+	struct dcp_sha_ctx *ctx = hash_ctx;
+	const u8 *p = buf;
+	unsigned int n, keep;
+	int ret = 0;
+
+	if (ctx->sw) {
+		if (ctx->sha256)
+			sha256_update(&ctx->sw_ctx.sha256, p, size);
+		else
+			sha1_update(&ctx->sw_ctx.sha1, p, size);
+		return 0;
+	}
+
+	n = min(size, DCP_SHA_BLOCK_SIZE - ctx->tail_len);
+	memcpy(ctx->tail + ctx->tail_len, p, n);
+	ctx->tail_len += n;
+	p += n;
+	size -= n;
+
+	if (size) {
+		ret = dcp_sha_send_tail(ctx, 0);
+		keep = size % DCP_SHA_BLOCK_SIZE ?: DCP_SHA_BLOCK_SIZE;
+		if (!ret && size > keep)
+			ret = dcp_sha_run(DCP_CHAN_SHA, ctx->sha256, p,
+					  size - keep, 0, NULL);
+		memcpy(ctx->tail, p + size - keep, keep);
+		ctx->tail_len = keep;
+	}
+	if (!ret && is_last && ctx->tail_len)
+		ret = dcp_sha_send_tail(ctx, 1);
+
+	if (ret)
+		dcp_sha_ctx_free(ctx);
+
+	return ret;
+}
+
+int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf,
+		  int size)
+{
+	struct dcp_sha_ctx *ctx = hash_ctx;
+	int ret = 0;
+
+	if (size < algo->digest_size) {
+		dcp_sha_ctx_free(ctx);
+		return -EINVAL;
+	}
+
+	if (ctx->sw) {
+		if (ctx->sha256)
+			sha256_finish(&ctx->sw_ctx.sha256, dest_buf);
+		else
+			sha1_finish(&ctx->sw_ctx.sha1, dest_buf);
+	} else if (!ctx->started && !ctx->tail_len) {
+		/* The engine cannot hash an empty message */
+		algo->hash_func_ws(NULL, 0, dest_buf, algo->chunk_size);
+	} else {
+		if (!ctx->done)
+			ret = dcp_sha_send_tail(ctx, 1);
+		if (!ret)
+			dcp_sha_copy_digest(dest_buf, ctx->digest,
+					    algo->digest_size);
+	}
+	dcp_sha_ctx_free(ctx);
+
+	return ret;
+}
+#endif /* CONFIG_SHA_PROG_HW_ACCEL */
+
+#ifdef CONFIG_AES_HW_ACCEL
+/*
+ * The data goes through bounce buffers, so it can sit anywhere (the
+ * environment is not even word aligned). Each chunk restarts the chain
+ * with the last ciphertext block of the previous one as IV.
+ *
+ * On error the caller redoes everything in software from @src, so @src
+ * must still be intact then. When the buffers overlap and there is more
+ * than one chunk, the output goes to a scratch buffer and is only copied
+ * to @dst once all of it is done.
+ */
+int hw_aes_cbc_crypt(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks,
+		     int enc)
+{
+	u32 size = num_aes_blocks * AES_KEY_LENGTH;
+	u8 *out = dst, *scratch = NULL;
+	struct dcp_desc *desc;
+	u32 len, chunk;
+	u8 *iv;
+	int ret = 0;
+
+	if (dcp_probe(DCP_CAPABILITY1_AES128))
+		return -ENODEV;
+
+	if (size > DCP_AES_BUF_SIZE && src < dst + size && dst < src + size) {
+		scratch = malloc(size);
+		if (!scratch)
+			return -ENOMEM;
+		out = scratch;
+	}
+
+	desc = &dcp->desc[DCP_CHAN_AES];
+	iv = dcp->aes_key + AES_KEY_LENGTH;
+	/* The expanded key starts with the key itself */
+	memcpy(dcp->aes_key, key_exp, AES_KEY_LENGTH);
+	memset(iv, 0, AES_KEY_LENGTH);
+
+	for (len = size; len; len -= chunk) {
+		chunk = min(len, (u32)DCP_AES_BUF_SIZE);
+		memcpy(dcp->aes_in, src, chunk);
+		dcp_flush(dcp->aes_in, chunk);
+		dcp_flush(dcp->aes_key, sizeof(dcp->aes_key));
+		dcp_invalidate(dcp->aes_out, chunk);
+
+		desc->control0 = DCP_CONTROL0_ENABLE_CIPHER |
+				 DCP_CONTROL0_CIPHER_INIT |
+				 DCP_CONTROL0_PAYLOAD_KEY;
+		if (enc)
+			desc->control0 |= DCP_CONTROL0_CIPHER_ENCRYPT;
+		desc->control1 = DCP_CONTROL1_CIPHER_SELECT_AES128 |
+				 DCP_CONTROL1_CIPHER_MODE_CBC;
+		desc->src = dcp_addr(dcp->aes_in);
+		desc->dst = dcp_addr(dcp->aes_out);
+		desc->size = chunk;
+		desc->payload = dcp_addr(dcp->aes_key);
+		ret = dcp_run(DCP_CHAN_AES);
+		if (ret)
+			break;
+
+		dcp_invalidate(dcp->aes_out, chunk);
+		memcpy(iv, (enc ? dcp->aes_out : dcp->aes_in) + chunk -
+		       AES_KEY_LENGTH, AES_KEY_LENGTH);
+		memcpy(out, dcp->aes_out, chunk);
+		src += chunk;
+		out += chunk;
+		WATCHDOG_RESET();
+	}
+
+	if (scratch) {
+		if (!ret)
+			memcpy(dst, scratch, size);
+		free(scratch);
+	}
+
+	return ret;
+}
+#endif /* CONFIG_AES_HW_ACCEL */
@@ -0,0 +1,114 @@
+/*
+ * Freescale i.MX23/i.MX28 Data Co-Processor (DCP) definitions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __MXS_DCP_H
+#define __MXS_DCP_H
+
+#define DCP_CHANNELS		4
+
+/* Every register has SET, CLR and TOG aliases, like mxs_reg_32() */
+#define dcp_reg(name)		\
+	u32 name;		\
+	u32 name##_set;		\
+	u32 name##_clr;		\
+	u32 name##_tog
+
+struct mxs_dcp_regs {
+	dcp_reg(ctrl);			/* 0x000 */
+	dcp_reg(stat);			/* 0x010 */
+	dcp_reg(channelctrl);		/* 0x020 */
+	dcp_reg(capability0);		/* 0x030 */
+	dcp_reg(capability1);		/* 0x040 */
+	dcp_reg(context);		/* 0x050 */
+	dcp_reg(key);			/* 0x060 */
+	dcp_reg(keydata);		/* 0x070 */
+	u32 packet[8][4];		/* 0x080 */
+	struct {
+		dcp_reg(cmdptr);
+		dcp_reg(sema);
+		dcp_reg(stat);
+		dcp_reg(opts);
+	} ch[DCP_CHANNELS];		/* 0x100 */
+};
+
+#define DCP_CTRL_SFTRST				(1 << 31)
+#define DCP_CTRL_CLKGATE			(1 << 30)
+#define DCP_CTRL_PRESENT_CRYPTO			(1 << 29)
+#define DCP_CTRL_PRESENT_SHA			(1 << 28)
+#define DCP_CTRL_GATHER_RESIDUAL_WRITES		(1 << 23)
+#define DCP_CTRL_ENABLE_CONTEXT_CACHING		(1 << 22)
+#define DCP_CTRL_ENABLE_CONTEXT_SWITCHING	(1 << 21)
+
+#define DCP_STAT_IRQ_MASK			0xf
+
+#define DCP_CHANNELCTRL_ENABLE_CHANNEL_MASK	0xff
+
+#define DCP_CAPABILITY1_SHA256			(1 << 18)
+#define DCP_CAPABILITY1_SHA1			(1 << 16)
+#define DCP_CAPABILITY1_AES128			(1 << 0)
+
+#define DCP_CH_SEMA_VALUE_MASK			(0xff << 16)
+#define DCP_CH_SEMA_INCREMENT_MASK		0xff
+
+#define DCP_CH_STAT_ERROR_CODE_MASK		(0xff << 16)
+#define DCP_CH_STAT_ERROR_PAGEFAULT		(1 << 6)
+#define DCP_CH_STAT_ERROR_DST			(1 << 5)
+#define DCP_CH_STAT_ERROR_SRC			(1 << 4)
+#define DCP_CH_STAT_ERROR_PACKET		(1 << 3)
+#define DCP_CH_STAT_ERROR_SETUP			(1 << 2)
+#define DCP_CH_STAT_HASH_MISMATCH		(1 << 1)
+#define DCP_CH_STAT_ERROR_MASK			0xff00fe
+
+/* Work packet, read by the engine from memory */
+struct dcp_desc {
+	u32	next;
+	u32	control0;
+	u32	control1;
+	u32	src;
+	u32	dst;
+	u32	size;
+	u32	payload;
+	u32	status;
+};
+
+#define DCP_CONTROL0_HASH_OUTPUT		(1 << 15)
+#define DCP_CONTROL0_CHECK_HASH			(1 << 14)
+#define DCP_CONTROL0_HASH_TERM			(1 << 13)
+#define DCP_CONTROL0_HASH_INIT			(1 << 12)
+#define DCP_CONTROL0_PAYLOAD_KEY		(1 << 11)
+#define DCP_CONTROL0_OTP_KEY			(1 << 10)
+#define DCP_CONTROL0_CIPHER_INIT		(1 << 9)
+#define DCP_CONTROL0_CIPHER_ENCRYPT		(1 << 8)
+#define DCP_CONTROL0_ENABLE_BLIT		(1 << 7)
+#define DCP_CONTROL0_ENABLE_HASH		(1 << 6)
+#define DCP_CONTROL0_ENABLE_CIPHER		(1 << 5)
+#define DCP_CONTROL0_ENABLE_MEMCOPY		(1 << 4)
+#define DCP_CONTROL0_CHAIN_CONTIGUOUS		(1 << 3)
+#define DCP_CONTROL0_CHAIN			(1 << 2)
+#define DCP_CONTROL0_DECR_SEMAPHORE		(1 << 1)
+#define DCP_CONTROL0_INTERRUPT			(1 << 0)
+
+#define DCP_CONTROL1_HASH_SELECT_MASK		(0xf << 16)
+#define DCP_CONTROL1_HASH_SELECT_SHA1		(0 << 16)
+#define DCP_CONTROL1_HASH_SELECT_SHA256		(2 << 16)
+#define DCP_CONTROL1_CIPHER_MODE_MASK		(0xf << 4)
+#define DCP_CONTROL1_CIPHER_MODE_ECB		(0 << 4)
+#define DCP_CONTROL1_CIPHER_MODE_CBC		(1 << 4)
+#define DCP_CONTROL1_CIPHER_SELECT_MASK		0xf
+#define DCP_CONTROL1_CIPHER_SELECT_AES128	0
+
+#define DCP_STATUS_COMPLETE			(1 << 0)
+
+/* The engine works on whole blocks until the packet that ends a hash */
+#define DCP_SHA_BLOCK_SIZE			64
+
+#ifdef CONFIG_MXS_DCP_SANDBOX
+/* Software model of the block, see mxs_dcp_sandbox.c */
+struct mxs_dcp_regs *sandbox_dcp_regs(void);
+void sandbox_dcp_run(int chan);
+#endif
+
+#endif /* __MXS_DCP_H */
@@ -0,0 +1,223 @@
+/*
+ * Software model of the i.MX23/i.MX28 DCP for sandbox
+ *
+ * The registers live in memory. When the driver bumps a channel semaphore
+ * it calls sandbox_dcp_run(), which walks the channel's packets the way the
+ * block does and computes the results with the software SHA and AES code.
+ * The model insists on what the driver relies on: the block must be taken
+ * out of reset, only the packet that ends a hash may be a partial block and
+ * ciphers take their key from the payload.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <aes.h>
+#include <asm/io.h>
+#include <asm/test.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include "mxs_dcp.h"
+
+static struct mxs_dcp_regs regs;
+static int packets;
+
+/* What the block keeps per channel between packets */
+static struct dcp_chan_state {
+	int sha256;
+	int hashing;
+	sha1_context sha1;
+	sha256_context sha256_ctx;
+	u8 key_exp[AES_EXPAND_KEY_LENGTH];
+	u8 iv[AES_KEY_LENGTH];
+} chan_state[DCP_CHANNELS];
+
+/* Apply what was written to the SET and CLR aliases of a register */
+static void sync_reg(u32 *reg)
+{
+	reg[0] = (reg[0] | reg[1]) & ~reg[2];
+	reg[1] = 0;
+	reg[2] = 0;
+}
+
+struct mxs_dcp_regs *sandbox_dcp_regs(void)
+{
+	/* Power-on state: held in reset, SHA and crypto present */
+	if (!regs.capability1) {
+		regs.ctrl = DCP_CTRL_SFTRST | DCP_CTRL_CLKGATE |
+			    DCP_CTRL_PRESENT_CRYPTO | DCP_CTRL_PRESENT_SHA;
+		regs.capability1 = DCP_CAPABILITY1_SHA256 |
+				   DCP_CAPABILITY1_SHA1 |
+				   DCP_CAPABILITY1_AES128;
+	}
+
+	return &regs;
+}
+
+int sandbox_dcp_packet_count(void)
+{
+	return packets;
+}
+
+static u32 run_hash(struct dcp_chan_state *cs, struct dcp_desc *desc,
+		    const u8 *src)
+{
+	u8 digest[SHA256_SUM_LEN];
+	u8 *out;
+	int i, len;
+
+	if (desc->control0 & DCP_CONTROL0_HASH_INIT) {
+		switch (desc->control1 & DCP_CONTROL1_HASH_SELECT_MASK) {
+		case DCP_CONTROL1_HASH_SELECT_SHA1:
+			cs->sha256 = 0;
+			sha1_starts(&cs->sha1);
+			break;
+		case DCP_CONTROL1_HASH_SELECT_SHA256:
+			cs->sha256 = 1;
+			sha256_starts(&cs->sha256_ctx);
+			break;
+		default:
+			return DCP_CH_STAT_ERROR_SETUP;
+		}
+		cs->hashing = 1;
+	}
+	if (!cs->hashing)
+		return DCP_CH_STAT_ERROR_SETUP;
+
+	if (desc->control0 & DCP_CONTROL0_HASH_TERM) {
+		if (!desc->size)
+			return DCP_CH_STAT_ERROR_PACKET;
+	} else if (desc->size % DCP_SHA_BLOCK_SIZE) {
+		return DCP_CH_STAT_ERROR_PACKET;
+	}
+
+	if (cs->sha256)
+		sha256_update(&cs->sha256_ctx, src, desc->size);
+	else
+		sha1_update(&cs->sha1, src, desc->size);
+
+	if (desc->control0 & DCP_CONTROL0_HASH_TERM) {
+		len = cs->sha256 ? SHA256_SUM_LEN : SHA1_SUM_LEN;
+		if (cs->sha256)
+			sha256_finish(&cs->sha256_ctx, digest);
+		else
+			sha1_finish(&cs->sha1, digest);
+		/* The block writes the digest least significant byte first */
+		out = map_sysmem(desc->payload, len);
+		for (i = 0; i < len; i++)
+			out[i] = digest[len - 1 - i];
+		cs->hashing = 0;
+	}
+
+	return 0;
+}
+
+static u32 run_cipher(struct dcp_chan_state *cs, struct dcp_desc *desc,
+		      const u8 *src)
+{
+	u8 *dst, *payload, tmp[AES_KEY_LENGTH];
+	int cbc, enc;
+	u32 i;
+
+	if ((desc->control1 & DCP_CONTROL1_CIPHER_SELECT_MASK) !=
+	    DCP_CONTROL1_CIPHER_SELECT_AES128 ||
+	    !(desc->control0 & DCP_CONTROL0_PAYLOAD_KEY))
+		return DCP_CH_STAT_ERROR_SETUP;
+	switch (desc->control1 & DCP_CONTROL1_CIPHER_MODE_MASK) {
+	case DCP_CONTROL1_CIPHER_MODE_ECB:
+		cbc = 0;
+		break;
+	case DCP_CONTROL1_CIPHER_MODE_CBC:
+		cbc = 1;
+		break;
+	default:
+		return DCP_CH_STAT_ERROR_SETUP;
+	}
+	if (desc->size % AES_KEY_LENGTH)
+		return DCP_CH_STAT_ERROR_PACKET;
+
+	payload = map_sysmem(desc->payload, 2 * AES_KEY_LENGTH);
+	aes_expand_key(payload, cs->key_exp);
+	if (desc->control0 & DCP_CONTROL0_CIPHER_INIT)
+		memcpy(cs->iv, payload + AES_KEY_LENGTH, AES_KEY_LENGTH);
+
+	enc = desc->control0 & DCP_CONTROL0_CIPHER_ENCRYPT;
+	dst = map_sysmem(desc->dst, desc->size);
+	for (i = 0; i < desc->size; i += AES_KEY_LENGTH) {
+		if (enc) {
+			memcpy(tmp, src + i, AES_KEY_LENGTH);
+			if (cbc)
+				aes_apply_cbc_chain_data(cs->iv, tmp, tmp);
+			aes_encrypt(tmp, cs->key_exp, dst + i);
+			memcpy(cs->iv, dst + i, AES_KEY_LENGTH);
+		} else {
+			memcpy(tmp, src + i, AES_KEY_LENGTH);
+			aes_decrypt(tmp, cs->key_exp, dst + i);
+			if (cbc)
+				aes_apply_cbc_chain_data(cs->iv, dst + i,
+							 dst + i);
+			memcpy(cs->iv, tmp, AES_KEY_LENGTH);
+		}
+	}
+
+	return 0;
+}
+
+static u32 run_packet(struct dcp_chan_state *cs, struct dcp_desc *desc)
+{
+	u32 ops = desc->control0 & (DCP_CONTROL0_ENABLE_HASH |
+				    DCP_CONTROL0_ENABLE_CIPHER |
+				    DCP_CONTROL0_ENABLE_MEMCOPY |
+				    DCP_CONTROL0_ENABLE_BLIT);
+	const u8 *src = map_sysmem(desc->src, desc->size);
+
+	/* Only what the driver uses is modelled */
+	if (ops == DCP_CONTROL0_ENABLE_HASH)
+		return run_hash(cs, desc, src);
+	if (ops == DCP_CONTROL0_ENABLE_CIPHER)
+		return run_cipher(cs, desc, src);
+
+	return DCP_CH_STAT_ERROR_SETUP;
+}
+
+void sandbox_dcp_run(int chan)
+{
+	struct dcp_chan_state *cs = &chan_state[chan];
+	struct dcp_desc *desc;
+	u32 addr, sema, stat = 0;
+	int i;
+
+	sync_reg(&regs.ctrl);
+	sync_reg(&regs.stat);
+	for (i = 0; i < DCP_CHANNELS; i++)
+		sync_reg(&regs.ch[i].stat);
+
+	/* The driver writes the increment, the value is what is left */
+	sema = (regs.ch[chan].sema & DCP_CH_SEMA_INCREMENT_MASK) +
+	       ((regs.ch[chan].sema & DCP_CH_SEMA_VALUE_MASK) >> 16);
+	regs.ch[chan].sema = sema << 16;
+	if (regs.ctrl & (DCP_CTRL_SFTRST | DCP_CTRL_CLKGATE) ||
+	    !(regs.channelctrl & (1 << chan)))
+		return;
+
+	addr = regs.ch[chan].cmdptr;
+	while (sema && !stat) {
+		desc = map_sysmem(addr, sizeof(*desc));
+		stat = run_packet(cs, desc);
+		packets++;
+		desc->status = stat ? stat : DCP_STATUS_COMPLETE;
+		if (desc->control0 & DCP_CONTROL0_DECR_SEMAPHORE)
+			sema--;
+		if (desc->control0 & DCP_CONTROL0_INTERRUPT)
+			regs.stat |= 1 << chan;
+		if (desc->control0 & DCP_CONTROL0_CHAIN)
+			addr = desc->next;
+		else if (desc->control0 & DCP_CONTROL0_CHAIN_CONTIGUOUS)
+			addr += sizeof(*desc);
+		else
+			break;
+	}
+	regs.ch[chan].cmdptr = addr;
+	regs.ch[chan].stat |= stat;
+	regs.ch[chan].sema = sema << 16;
+}
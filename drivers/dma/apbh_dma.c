@@ -24,6 +24,14 @@
 
 static struct mxs_dma_chan mxs_dma_channels[MXS_MAX_DMA_CHANNELS];
 
+/*
+ * Preallocated descriptor ring. mxs_dma_desc_alloc() hands out entries from
+ * here round-robin and only falls back to memalign() once all are in use.
+ */
+static struct mxs_dma_desc mxs_dma_desc_pool[MXS_DMA_DESC_POOL_SIZE];
+static uint32_t mxs_dma_desc_pool_used;
+static unsigned int mxs_dma_desc_pool_next;
+
 /*
  * Test is the DMA channel is valid channel
  */
@@ -338,11 +346,27 @@ int mxs_dma_release(int channel)
  */
 struct mxs_dma_desc *mxs_dma_desc_alloc(void)
 {
-	struct mxs_dma_desc *pdesc;
+	struct mxs_dma_desc *pdesc = NULL;
+	unsigned int i, idx;
 	uint32_t size;
 
-	size = roundup(sizeof(struct mxs_dma_desc), MXS_DMA_ALIGNMENT);
-	pdesc = memalign(MXS_DMA_ALIGNMENT, size);
+	BUILD_BUG_ON(MXS_DMA_DESC_POOL_SIZE > 32);
+
+	for (i = 0; i < MXS_DMA_DESC_POOL_SIZE; i++) {
+		idx = (mxs_dma_desc_pool_next + i) % MXS_DMA_DESC_POOL_SIZE;
+		if (mxs_dma_desc_pool_used & (1 << idx))
+			continue;
+
+		mxs_dma_desc_pool_used |= 1 << idx;
+		mxs_dma_desc_pool_next = idx + 1;
+		pdesc = &mxs_dma_desc_pool[idx];
+		break;
+	}
+
+	if (pdesc == NULL) {
+		size = roundup(sizeof(struct mxs_dma_desc), MXS_DMA_ALIGNMENT);
+		pdesc = memalign(MXS_DMA_ALIGNMENT, size);
+	}
 
 	if (pdesc == NULL)
 		return NULL;
@@ -358,9 +382,18 @@ struct mxs_dma_desc *mxs_dma_desc_alloc(void)
  */
 void mxs_dma_desc_free(struct mxs_dma_desc *pdesc)
 {
+	unsigned int idx;
+
 	if (pdesc == NULL)
 		return;
 
+	if (pdesc >= mxs_dma_desc_pool &&
+	    pdesc < mxs_dma_desc_pool + MXS_DMA_DESC_POOL_SIZE) {
+		idx = pdesc - mxs_dma_desc_pool;
+		mxs_dma_desc_pool_used &= ~(1 << idx);
+		return;
+	}
+
 	free(pdesc);
 }
 
@@ -495,53 +528,162 @@ static int mxs_dma_finish(int channel, struct list_head *head)
 }
 
 /*
- * Wait for DMA channel to complete
+ * Retire the chain running on a channel and shut the channel down.
+ */
+static void mxs_dma_complete(int chan, int status)
+{
+	struct mxs_dma_chan *pchan = mxs_dma_channels + chan;
+	mxs_dma_callback_t callback = pchan->callback;
+	void *data = pchan->callback_data;
+
+	LIST_HEAD(tmp_desc_list);
+
+	if (status)
+		mxs_dma_reset(chan);
+
+	/* Clear out the descriptors we just ran. */
+	mxs_dma_finish(chan, &tmp_desc_list);
+
+	/* Shut the DMA channel down. */
+	mxs_dma_ack_irq(chan);
+	mxs_dma_reset(chan);
+	mxs_dma_enable_irq(chan, 0);
+	mxs_dma_disable(chan);
+
+	pchan->flags &= ~MXS_DMA_FLAGS_SUBMITTED;
+	pchan->completed = pchan->cookie;
+	pchan->callback = NULL;
+	pchan->callback_data = NULL;
+
+	if (callback)
+		callback(chan, status, data);
+}
+
+/*
+ * Start the chain queued on a channel with mxs_dma_desc_append() and return
+ * without waiting for it. Only one chain may be in flight per channel.
+ *
+ * Returns a positive cookie to be passed to mxs_dma_is_done() or
+ * mxs_dma_wait(), or a negative error code.
  */
-static int mxs_dma_wait_complete(uint32_t timeout, unsigned int chan)
+mxs_dma_cookie_t mxs_dma_submit(int chan, mxs_dma_callback_t callback,
+				void *data)
+{
+	struct mxs_dma_chan *pchan;
+	mxs_dma_cookie_t seq;
+	int ret;
+
+	ret = mxs_dma_validate_chan(chan);
+	if (ret)
+		return ret;
+
+	pchan = mxs_dma_channels + chan;
+	if (pchan->flags & MXS_DMA_FLAGS_SUBMITTED)
+		return -EBUSY;
+
+	seq = (pchan->cookie >> MXS_DMA_COOKIE_CHAN_BITS) + 1;
+	if (seq > (INT_MAX >> MXS_DMA_COOKIE_CHAN_BITS))
+		seq = 1;
+
+	pchan->cookie = (seq << MXS_DMA_COOKIE_CHAN_BITS) | chan;
+	pchan->callback = callback;
+	pchan->callback_data = data;
+	pchan->flags |= MXS_DMA_FLAGS_SUBMITTED;
+
+	mxs_dma_enable_irq(chan, 1);
+	mxs_dma_enable(chan);
+
+	return pchan->cookie;
+}
+
+/*
+ * Check whether the chain identified by the cookie has finished.
+ *
+ * If the hardware has completed the chain since the last poll, the channel
+ * is shut down and the completion callback is run from here.
+ *
+ * Returns 1 if done, 0 if still running, or a negative error code.
+ */
+int mxs_dma_is_done(mxs_dma_cookie_t cookie)
 {
 	struct mxs_apbh_regs *apbh_regs =
 		(struct mxs_apbh_regs *)MXS_APBH_BASE;
+	int chan = cookie & MXS_DMA_COOKIE_CHAN_MASK;
+	struct mxs_dma_chan *pchan;
 	int ret;
 
+	if (cookie <= 0)
+		return -EINVAL;
+
 	ret = mxs_dma_validate_chan(chan);
 	if (ret)
 		return ret;
 
-	if (mxs_wait_mask_set(&apbh_regs->hw_apbh_ctrl1_reg,
-				1 << chan, timeout)) {
-		ret = -ETIMEDOUT;
-		mxs_dma_reset(chan);
-	}
+	pchan = mxs_dma_channels + chan;
+	if (!(pchan->flags & MXS_DMA_FLAGS_SUBMITTED) ||
+	    pchan->cookie != cookie)
+		return 1;
 
-	return ret;
+	if (!(readl(&apbh_regs->hw_apbh_ctrl1_reg) & (1 << chan)))
+		return 0;
+
+	mxs_dma_complete(chan, 0);
+
+	return 1;
 }
 
 /*
- * Execute the DMA channel
+ * Busy-wait for a submitted chain, for at most timeout microseconds.
+ * The chain is aborted when the timeout expires.
  */
-int mxs_dma_go(int chan)
+int mxs_dma_wait(mxs_dma_cookie_t cookie, uint32_t timeout)
 {
-	uint32_t timeout = 10000000;
 	int ret;
 
-	LIST_HEAD(tmp_desc_list);
+	while (--timeout) {
+		ret = mxs_dma_is_done(cookie);
+		if (ret)
+			return ret < 0 ? ret : 0;
+		udelay(1);
+	}
 
-	mxs_dma_enable_irq(chan, 1);
-	mxs_dma_enable(chan);
+	ret = mxs_dma_is_done(cookie);
+	if (ret)
+		return ret < 0 ? ret : 0;
 
-	/* Wait for DMA to finish. */
-	ret = mxs_dma_wait_complete(timeout, chan);
+	mxs_dma_complete(cookie & MXS_DMA_COOKIE_CHAN_MASK, -ETIMEDOUT);
 
-	/* Clear out the descriptors we just ran. */
-	mxs_dma_finish(chan, &tmp_desc_list);
+	return -ETIMEDOUT;
+}
 
-	/* Shut the DMA channel down. */
-	mxs_dma_ack_irq(chan);
-	mxs_dma_reset(chan);
-	mxs_dma_enable_irq(chan, 0);
-	mxs_dma_disable(chan);
+/*
+ * Poll every channel with a submitted chain, running the completion
+ * callbacks of those that have finished.
+ */
+void mxs_dma_poll(void)
+{
+	struct mxs_dma_chan *pchan;
+	int chan;
 
-	return ret;
+	for (chan = 0; chan < MXS_MAX_DMA_CHANNELS; chan++) {
+		pchan = mxs_dma_channels + chan;
+		if (pchan->flags & MXS_DMA_FLAGS_SUBMITTED)
+			mxs_dma_is_done(pchan->cookie);
+	}
+}
+
+/*
+ * Execute the DMA channel
+ */
+int mxs_dma_go(int chan)
+{
+	mxs_dma_cookie_t cookie;
+
+	cookie = mxs_dma_submit(chan, NULL, NULL);
+	if (cookie < 0)
+		return cookie;
+
+	return mxs_dma_wait(cookie, 10000000);
 }
 
 /*
@@ -11,6 +11,8 @@
 #include <common.h>
 #include <command.h>
 #include <errno.h>
+#include <fat.h>
+#include <hash.h>
 #include <mmc.h>
 #include <part.h>
 #include <malloc.h>
@@ -256,6 +258,7 @@ static ulong mmc_bread(int dev_num, lbaint_t start, lbaint_t blkcnt, void *dst)
 			mmc->cfg->b_max : blocks_todo;
 		if(mmc_read_blocks(mmc, dst, start, cur) != cur)
 			return 0;
+		hash_load_data(dst, cur * mmc->read_bl_len);
 		blocks_todo -= cur;
 		start += cur;
 		dst += cur * mmc->read_bl_len;
@@ -1588,6 +1591,8 @@ int mmc_start_init(struct mmc *mmc)
 	if (mmc->has_init)
 		return 0;
 
+	/* After a rescan this may well be another card */
+	fat_invalidate();
 	board_mmc_power_init();
 
 	/* made sure it's not NULL earlier */
@@ -9,6 +9,7 @@
 
 #include <config.h>
 #include <common.h>
+#include <fat.h>
 #include <part.h>
 #include "mmc_private.h"
 
@@ -73,6 +74,7 @@ unsigned long mmc_berase(int dev_num, lbaint_t start, lbaint_t blkcnt)
 	if (!mmc)
 		return -1;
 
+	fat_invalidate();
 	if ((start % mmc->erase_grp_size) || (blkcnt % mmc->erase_grp_size))
 		printf("\n\nCaution! Your devices Erase group is 0x%x\n"
 		       "The erase range would be change to "
@@ -163,6 +165,9 @@ ulong mmc_bwrite(int dev_num, lbaint_t start, lbaint_t blkcnt, const void *src)
 	if (!mmc)
 		return 0;
 
+	/* The blocks may belong to the mounted FAT volume */
+	fat_invalidate();
+
 	if (mmc_set_blocklen(mmc, mmc->write_bl_len))
 		return 0;
 
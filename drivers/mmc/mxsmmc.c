@@ -28,19 +28,35 @@
 #include <asm/imx-common/dma.h>
 #include <bouncebuf.h>
 
+#define	MXSMMC_MAX_TIMEOUT	10000
+#define MXSMMC_SMALL_TRANSFER	512
+
+/*
+ * A command moves up to MXSMMC_MAX_BLOCKS blocks, by a chain of DMA
+ * descriptors of up to MXSMMC_DMA_CHUNK bytes each, as the byte count
+ * of a descriptor is 16 bits wide. On the i.MX23 the transfer size and
+ * block count of the SSP are 16 and 8 bits wide, so one command has to
+ * fit into 64 KiB there.
+ */
+#if defined(CONFIG_MX23)
+#define MXSMMC_MAX_BLOCKS	(0xffff / 512)
+#else
+#define MXSMMC_MAX_BLOCKS	2048
+#endif
+#define MXSMMC_DMA_CHUNK	0xf000
+#define MXSMMC_DMA_DESCS	\
+	DIV_ROUND_UP(MXSMMC_MAX_BLOCKS * 512, MXSMMC_DMA_CHUNK)
+
 struct mxsmmc_priv {
 	int			id;
 	struct mxs_ssp_regs	*regs;
 	uint32_t		buswidth;
 	int			(*mmc_is_wp)(int);
 	int			(*mmc_cd)(int);
-	struct mxs_dma_desc	*desc;
+	struct mxs_dma_desc	*desc[MXSMMC_DMA_DESCS];
 	struct mmc_config	cfg;	/* mmc configuration */
 };
 
-#define	MXSMMC_MAX_TIMEOUT	10000
-#define MXSMMC_SMALL_TRANSFER	512
-
 static int mxsmmc_cd(struct mxsmmc_priv *priv)
 {
 	struct mxs_ssp_regs *ssp_regs = priv->regs;
@@ -87,45 +103,69 @@ static int mxsmmc_send_cmd_pio(struct mxsmmc_priv *priv, struct mmc_data *data)
 	return timeout ? 0 : COMM_ERR;
 }
 
-static int mxsmmc_send_cmd_dma(struct mxsmmc_priv *priv, struct mmc_data *data)
+/*
+ * Get the buffer a DMA transfer goes to or comes from. An unaligned one needs
+ * a bounce buffer of up to b_max blocks, so this is done before the command
+ * is sent: once the card expects data, there is no clean way back.
+ */
+static int mxsmmc_dma_start(struct mmc_data *data,
+			    struct bounce_buffer *bbstate)
 {
 	uint32_t data_count = data->blocksize * data->blocks;
-	int dmach;
-	struct mxs_dma_desc *desc = priv->desc;
 	void *addr;
 	unsigned int flags;
-	struct bounce_buffer bbstate;
 
-	memset(desc, 0, sizeof(struct mxs_dma_desc));
-	desc->address = (dma_addr_t)desc;
+	if (data_count > MXSMMC_DMA_DESCS * MXSMMC_DMA_CHUNK)
+		return COMM_ERR;
 
 	if (data->flags & MMC_DATA_READ) {
-		priv->desc->cmd.data = MXS_DMA_DESC_COMMAND_DMA_WRITE;
 		addr = data->dest;
 		flags = GEN_BB_WRITE;
 	} else {
-		priv->desc->cmd.data = MXS_DMA_DESC_COMMAND_DMA_READ;
 		addr = (void *)data->src;
 		flags = GEN_BB_READ;
 	}
 
-	bounce_buffer_start(&bbstate, addr, data_count, flags);
+	if (bounce_buffer_start(bbstate, addr, data_count, flags)) {
+		printf("MMC: no memory to bounce %u bytes\n", data_count);
+		return COMM_ERR;
+	}
 
-	priv->desc->cmd.address = (dma_addr_t)bbstate.bounce_buffer;
+	return 0;
+}
 
-	priv->desc->cmd.data |= MXS_DMA_DESC_IRQ | MXS_DMA_DESC_DEC_SEM |
-				(data_count << MXS_DMA_DESC_BYTES_OFFSET);
+static int mxsmmc_send_cmd_dma(struct mxsmmc_priv *priv, struct mmc_data *data,
+			       struct bounce_buffer *bbstate)
+{
+	uint32_t data_count = data->blocksize * data->blocks;
+	uint32_t command, len, off;
+	int dmach, i;
+	struct mxs_dma_desc *desc;
+
+	if (data->flags & MMC_DATA_READ)
+		command = MXS_DMA_DESC_COMMAND_DMA_WRITE;
+	else
+		command = MXS_DMA_DESC_COMMAND_DMA_READ;
 
+	/* Chain the descriptors; the last one ends the transfer */
 	dmach = MXS_DMA_CHANNEL_AHB_APBH_SSP0 + priv->id;
-	mxs_dma_desc_append(dmach, priv->desc);
-	if (mxs_dma_go(dmach)) {
-		bounce_buffer_stop(&bbstate);
-		return COMM_ERR;
-	}
+	for (i = 0, off = 0; off < data_count; i++, off += len) {
+		len = min(data_count - off, (uint32_t)MXSMMC_DMA_CHUNK);
 
-	bounce_buffer_stop(&bbstate);
+		desc = priv->desc[i];
+		memset(desc, 0, sizeof(struct mxs_dma_desc));
+		desc->address = (dma_addr_t)desc;
 
-	return 0;
+		desc->cmd.address = (dma_addr_t)bbstate->bounce_buffer + off;
+		desc->cmd.data = command | (len << MXS_DMA_DESC_BYTES_OFFSET);
+		if (off + len == data_count)
+			desc->cmd.data |= MXS_DMA_DESC_IRQ |
+					  MXS_DMA_DESC_DEC_SEM;
+
+		mxs_dma_desc_append(dmach, desc);
+	}
+
+	return mxs_dma_go(dmach) ? COMM_ERR : 0;
 }
 
 /*
@@ -140,7 +180,8 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	uint32_t reg;
 	int timeout;
 	uint32_t ctrl0;
-	int ret;
+	struct bounce_buffer bbstate;
+	int dma, ret;
 
 	debug("MMC%d: CMD%d\n", mmc->block_dev.dev, cmd->cmdidx);
 
@@ -178,7 +219,8 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	if (cmd->resp_type & MMC_RSP_136)	/* It's a 136 bits response */
 		ctrl0 |= SSP_CTRL0_LONG_RESP;
 
-	if (data && (data->blocksize * data->blocks < MXSMMC_SMALL_TRANSFER))
+	dma = data && data->blocksize * data->blocks >= MXSMMC_SMALL_TRANSFER;
+	if (data && !dma)
 		writel(SSP_CTRL1_DMA_ENABLE, &ssp_regs->hw_ssp_ctrl1_clr);
 	else
 		writel(SSP_CTRL1_DMA_ENABLE, &ssp_regs->hw_ssp_ctrl1_set);
@@ -228,6 +270,12 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 #endif
 	}
 
+	if (dma) {
+		ret = mxsmmc_dma_start(data, &bbstate);
+		if (ret)
+			return ret;
+	}
+
 	/* Kick off the command */
 	ctrl0 |= SSP_CTRL0_WAIT_FOR_IRQ | SSP_CTRL0_ENABLE | SSP_CTRL0_RUN;
 	writel(ctrl0, &ssp_regs->hw_ssp_ctrl0);
@@ -244,21 +292,24 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	if (!timeout) {
 		printf("MMC%d: Command %d busy\n",
 			mmc->block_dev.dev, cmd->cmdidx);
-		return TIMEOUT;
+		ret = TIMEOUT;
+		goto out;
 	}
 
 	/* Check command timeout */
 	if (reg & SSP_STATUS_RESP_TIMEOUT) {
 		printf("MMC%d: Command %d timeout (status 0x%08x)\n",
 			mmc->block_dev.dev, cmd->cmdidx, reg);
-		return TIMEOUT;
+		ret = TIMEOUT;
+		goto out;
 	}
 
 	/* Check command errors */
 	if (reg & (SSP_STATUS_RESP_CRC_ERR | SSP_STATUS_RESP_ERR)) {
 		printf("MMC%d: Command %d error (status 0x%08x)!\n",
 			mmc->block_dev.dev, cmd->cmdidx, reg);
-		return COMM_ERR;
+		ret = COMM_ERR;
+		goto out;
 	}
 
 	/* Copy response to response buffer */
@@ -274,7 +325,7 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	if (!data)
 		return 0;
 
-	if (data->blocksize * data->blocks < MXSMMC_SMALL_TRANSFER) {
+	if (!dma) {
 		ret = mxsmmc_send_cmd_pio(priv, data);
 		if (ret) {
 			printf("MMC%d: Data timeout with command %d "
@@ -283,11 +334,11 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 			return ret;
 		}
 	} else {
-		ret = mxsmmc_send_cmd_dma(priv, data);
+		ret = mxsmmc_send_cmd_dma(priv, data, &bbstate);
 		if (ret) {
 			printf("MMC%d: DMA transfer failed\n",
 				mmc->block_dev.dev);
-			return ret;
+			goto out;
 		}
 	}
 
@@ -298,10 +349,14 @@ mxsmmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 		SSP_STATUS_FIFO_OVRFLW | SSP_STATUS_FIFO_UNDRFLW)) {
 		printf("MMC%d: Data error with command %d (status 0x%08x)!\n",
 			mmc->block_dev.dev, cmd->cmdidx, reg);
-		return COMM_ERR;
+		ret = COMM_ERR;
 	}
 
-	return 0;
+out:
+	if (dma)
+		bounce_buffer_stop(&bbstate);
+
+	return ret;
 }
 
 static void mxsmmc_set_ios(struct mmc *mmc)
@@ -374,20 +429,20 @@ int mxsmmc_initialize(bd_t *bis, int id, int (*wp)(int), int (*cd)(int))
 {
 	struct mmc *mmc = NULL;
 	struct mxsmmc_priv *priv = NULL;
-	int ret;
+	int i, ret;
 	const unsigned int mxsmmc_clk_id = mxs_ssp_clock_by_bus(id);
 
 	if (!mxs_ssp_bus_id_valid(id))
 		return -ENODEV;
 
-	priv = malloc(sizeof(struct mxsmmc_priv));
+	priv = calloc(1, sizeof(struct mxsmmc_priv));
 	if (!priv)
 		return -ENOMEM;
 
-	priv->desc = mxs_dma_desc_alloc();
-	if (!priv->desc) {
-		free(priv);
-		return -ENOMEM;
+	for (i = 0; i < MXSMMC_DMA_DESCS; i++) {
+		priv->desc[i] = mxs_dma_desc_alloc();
+		if (!priv->desc[i])
+			goto err_desc;
 	}
 
 	ret = mxs_dma_init_channel(MXS_DMA_CHANNEL_AHB_APBH_SSP0 + id);
@@ -416,13 +471,16 @@ int mxsmmc_initialize(bd_t *bis, int id, int (*wp)(int), int (*cd)(int))
 	 */
 	priv->cfg.f_min = 400000;
 	priv->cfg.f_max = mxc_get_clock(MXC_SSP0_CLK + mxsmmc_clk_id) * 1000 / 2;
-	priv->cfg.b_max = 0x20;
+	priv->cfg.b_max = MXSMMC_MAX_BLOCKS;
 
 	mmc = mmc_create(&priv->cfg, priv);
-	if (mmc == NULL) {
-		mxs_dma_desc_free(priv->desc);
-		free(priv);
-		return -ENOMEM;
-	}
+	if (mmc == NULL)
+		goto err_desc;
 	return 0;
+
+err_desc:
+	for (i = 0; i < MXSMMC_DMA_DESCS; i++)
+		mxs_dma_desc_free(priv->desc[i]);
+	free(priv);
+	return -ENOMEM;
 }
@@ -14,10 +14,12 @@
  */
 
 #include <common.h>
+#include <hash.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/nand.h>
 #include <linux/types.h>
 #include <malloc.h>
+#include <watchdog.h>
 #include <asm/errno.h>
 #include <asm/io.h>
 #include <asm/arch/clock.h>
@@ -27,7 +29,7 @@
 #include <asm/arch/sys_proto.h>
 #include <asm/imx-common/dma.h>
 
-#define	MXS_NAND_DMA_DESCRIPTOR_COUNT		4
+#define	MXS_NAND_DMA_DESCRIPTOR_COUNT		5
 
 #define	MXS_NAND_CHUNK_DATA_CHUNK_SIZE		512
 #if defined(CONFIG_MX6)
@@ -41,6 +43,10 @@
 
 #define	MXS_NAND_BCH_TIMEOUT			10000
 
+/* ONFI cache read commands */
+#define	MXS_NAND_CMD_READ_CACHE_SEQ		0x31
+#define	MXS_NAND_CMD_READ_CACHE_END		0x3f
+
 struct mxs_nand_info {
 	int		cur_chip;
 
@@ -55,6 +61,8 @@ struct mxs_nand_info {
 	uint8_t		raw_oob_mode;
 
 	/* Functions with altered behaviour */
+	int		(*hooked_read)(struct mtd_info *mtd, loff_t from,
+				size_t len, size_t *retlen, uint8_t *buf);
 	int		(*hooked_read_oob)(struct mtd_info *mtd,
 				loff_t from, struct mtd_oob_ops *ops);
 	int		(*hooked_write_oob)(struct mtd_info *mtd,
@@ -65,6 +73,11 @@ struct mxs_nand_info {
 	/* DMA descriptors */
 	struct mxs_dma_desc	**desc;
 	uint32_t		desc_index;
+
+	/* Page read statistics */
+	uint32_t		direct_pages;
+	uint32_t		bounce_pages;
+	uint32_t		cache_read_pages;
 };
 
 struct nand_ecclayout fake_ecc_layout;
@@ -87,6 +100,21 @@ static void mxs_nand_inval_data_buf(struct mxs_nand_info *info)
 	invalidate_dcache_range(addr, addr + info->data_buf_size);
 }
 
+static void mxs_nand_inval_oob_buf(struct mxs_nand_info *info)
+{
+	uint32_t addr = (uint32_t)info->oob_buf;
+	uint32_t end = (uint32_t)info->data_buf + info->data_buf_size;
+
+	invalidate_dcache_range(addr, end);
+}
+
+static void mxs_nand_inval_page_buf(uint8_t *buf, uint32_t size)
+{
+	uint32_t addr = (uint32_t)buf;
+
+	invalidate_dcache_range(addr, addr + size);
+}
+
 static void mxs_nand_flush_cmd_buf(struct mxs_nand_info *info)
 {
 	uint32_t addr = (uint32_t)info->cmd_buf;
@@ -96,9 +124,27 @@ static void mxs_nand_flush_cmd_buf(struct mxs_nand_info *info)
 #else
 static inline void mxs_nand_flush_data_buf(struct mxs_nand_info *info) {}
 static inline void mxs_nand_inval_data_buf(struct mxs_nand_info *info) {}
+static inline void mxs_nand_inval_oob_buf(struct mxs_nand_info *info) {}
+static inline void mxs_nand_inval_page_buf(uint8_t *buf, uint32_t size) {}
 static inline void mxs_nand_flush_cmd_buf(struct mxs_nand_info *info) {}
 #endif
 
+/*
+ * The BCH engine can write the page payload straight into the caller's
+ * buffer, provided the buffer can be invalidated without touching any
+ * neighbouring data. Otherwise the payload goes through data_buf.
+ */
+static int mxs_nand_can_read_direct(struct mtd_info *mtd, uint8_t *buf)
+{
+	if ((uint32_t)buf & (MXS_DMA_ALIGNMENT - 1))
+		return 0;
+
+	if (mtd->writesize & (MXS_DMA_ALIGNMENT - 1))
+		return 0;
+
+	return 1;
+}
+
 static struct mxs_dma_desc *mxs_nand_get_dma_desc(struct mxs_nand_info *info)
 {
 	struct mxs_dma_desc *desc;
@@ -248,6 +294,42 @@ static int mxs_nand_wait_for_bch_complete(void)
 	return ret;
 }
 
+#ifdef CONFIG_NAND_MXS_CACHE_READ
+/*
+ * Queue a single command byte on the channel without starting the DMA. The
+ * descriptor is executed as the head of the next chain passed to mxs_dma_go().
+ */
+static void mxs_nand_queue_cmd(struct mtd_info *mtd, uint8_t cmd)
+{
+	struct nand_chip *nand = mtd->priv;
+	struct mxs_nand_info *nand_info = nand->priv;
+	struct mxs_dma_desc *d;
+	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
+
+	nand_info->cmd_buf[0] = cmd;
+
+	d = mxs_nand_get_dma_desc(nand_info);
+	d->cmd.data =
+		MXS_DMA_DESC_COMMAND_DMA_READ | MXS_DMA_DESC_CHAIN |
+		MXS_DMA_DESC_WAIT4END | (3 << MXS_DMA_DESC_PIO_WORDS_OFFSET) |
+		(1 << MXS_DMA_DESC_BYTES_OFFSET);
+
+	d->cmd.address = (dma_addr_t)nand_info->cmd_buf;
+
+	d->cmd.pio_words[0] =
+		GPMI_CTRL0_COMMAND_MODE_WRITE |
+		GPMI_CTRL0_WORD_LENGTH |
+		(nand_info->cur_chip << GPMI_CTRL0_CS_OFFSET) |
+		GPMI_CTRL0_ADDRESS_NAND_CLE |
+		1;
+
+	mxs_dma_desc_append(channel, d);
+
+	/* Flush caches */
+	mxs_nand_flush_cmd_buf(nand_info);
+}
+#endif
+
 /*
  * This is the function that we install in the cmd_ctrl function pointer of the
  * owning struct nand_chip. The only functions in the reference implementation
@@ -557,8 +639,21 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 	uint32_t channel = MXS_DMA_CHANNEL_AHB_APBH_GPMI0 + nand_info->cur_chip;
 	uint32_t corrected = 0, failed = 0;
 	uint8_t	*status;
+	uint8_t *data_buf;
 	int i, ret;
 
+	/* Decode straight into the caller's buffer whenever possible. */
+	if (mxs_nand_can_read_direct(mtd, buf)) {
+		data_buf = buf;
+		nand_info->direct_pages++;
+
+		/* Drop any dirty lines before the DMA overwrites the buffer */
+		mxs_nand_inval_page_buf(data_buf, mtd->writesize);
+	} else {
+		data_buf = nand_info->data_buf;
+		nand_info->bounce_pages++;
+	}
+
 	/* Compile the DMA descriptor - wait for ready. */
 	d = mxs_nand_get_dma_desc(nand_info);
 	d->cmd.data =
@@ -596,7 +691,7 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 		GPMI_ECCCTRL_ECC_CMD_DECODE |
 		GPMI_ECCCTRL_BUFFER_MASK_BCH_PAGE;
 	d->cmd.pio_words[3] = mtd->writesize + mtd->oobsize;
-	d->cmd.pio_words[4] = (dma_addr_t)nand_info->data_buf;
+	d->cmd.pio_words[4] = (dma_addr_t)data_buf;
 	d->cmd.pio_words[5] = (dma_addr_t)nand_info->oob_buf;
 
 	mxs_dma_desc_append(channel, d);
@@ -645,10 +740,15 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 	}
 
 	/* Invalidate caches */
-	mxs_nand_inval_data_buf(nand_info);
+	if (data_buf == buf) {
+		mxs_nand_inval_page_buf(data_buf, mtd->writesize);
+		mxs_nand_inval_oob_buf(nand_info);
+	} else {
+		mxs_nand_inval_data_buf(nand_info);
+	}
 
 	/* Read DMA completed, now do the mark swapping. */
-	mxs_nand_swap_block_mark(mtd, nand_info->data_buf, nand_info->oob_buf);
+	mxs_nand_swap_block_mark(mtd, data_buf, nand_info->oob_buf);
 
 	/* Loop over status bytes, accumulating ECC status. */
 	status = nand_info->oob_buf + mxs_nand_aux_status_offset();
@@ -684,7 +784,8 @@ static int mxs_nand_ecc_read_page(struct mtd_info *mtd, struct nand_chip *nand,
 
 	nand->oob_poi[0] = nand_info->oob_buf[0];
 
-	memcpy(buf, nand_info->data_buf, mtd->writesize);
+	if (data_buf != buf)
+		memcpy(buf, data_buf, mtd->writesize);
 
 rtn:
 	mxs_nand_return_dma_descs(nand_info);
@@ -756,6 +857,129 @@ rtn:
 	return 0;
 }
 
+#ifdef CONFIG_NAND_MXS_CACHE_READ
+/*
+ * Check if a read can use the ONFI cache read sequence. The request must
+ * cover at least two whole pages of a single chip and land in a buffer the
+ * BCH engine can write to directly.
+ */
+static int mxs_nand_can_read_cached(struct mtd_info *mtd, loff_t from,
+					size_t len, uint8_t *buf)
+{
+	struct nand_chip *nand = mtd->priv;
+
+	if (!nand->onfi_version)
+		return 0;
+
+	if (!(le16_to_cpu(nand->onfi_params.opt_cmd) &
+	      ONFI_OPT_CMD_READ_CACHE))
+		return 0;
+
+	if ((from | len) & (mtd->writesize - 1))
+		return 0;
+
+	if (len < 2 * mtd->writesize || from + len > mtd->size)
+		return 0;
+
+	if ((from >> nand->chip_shift) != ((from + len - 1) >> nand->chip_shift))
+		return 0;
+
+	return mxs_nand_can_read_direct(mtd, buf);
+}
+
+/*
+ * Read consecutive pages using READ CACHE SEQUENTIAL.
+ *
+ * After the initial READ0/READSTART, each page is fetched by queueing 0x31
+ * in front of the BCH read chain. The chip then copies the page to its cache
+ * register and immediately starts loading the following page from the array,
+ * so the array read time (tR) of page N+1 runs while page N is transferred
+ * and decoded. The last page of an erase block, or of the request, is
+ * fetched with 0x3f so the chip does not read ahead past it.
+ *
+ * Returns -EBADMSG if any page had uncorrectable errors. On any error the
+ * ECC statistics are left as they were, since the caller reads the same
+ * pages again through the slow path, which counts them itself.
+ */
+static int mxs_nand_read_cached(struct mtd_info *mtd, loff_t from,
+				size_t len, uint8_t *buf)
+{
+	struct nand_chip *nand = mtd->priv;
+	struct mxs_nand_info *nand_info = nand->priv;
+	struct mtd_ecc_stats stats = mtd->ecc_stats;
+	uint32_t block_mask;
+	int page, npages, i, last;
+	int ret = 0;
+
+	block_mask = (1 << (nand->phys_erase_shift - nand->page_shift)) - 1;
+	page = (int)(from >> nand->page_shift) & nand->pagemask;
+	npages = len >> nand->page_shift;
+
+	nand->select_chip(mtd, (int)(from >> nand->chip_shift));
+
+	for (i = 0; i < npages; i++, page++) {
+		WATCHDOG_RESET();
+
+		/* Start a new sequence at the beginning of every block. */
+		if (i == 0 || !(page & block_mask))
+			nand->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+
+		last = (i == npages - 1) || !((page + 1) & block_mask);
+
+		mxs_nand_queue_cmd(mtd, last ? MXS_NAND_CMD_READ_CACHE_END :
+					MXS_NAND_CMD_READ_CACHE_SEQ);
+
+		ret = mxs_nand_ecc_read_page(mtd, nand, buf, 0, page);
+		if (ret)
+			break;
+
+		/*
+		 * A page with uncorrectable errors is read again by the slow
+		 * path, which passes it on to the load hash from there.
+		 */
+		if (mtd->ecc_stats.failed == stats.failed)
+			hash_load_data(buf, mtd->writesize);
+		nand_info->cache_read_pages++;
+		buf += mtd->writesize;
+	}
+
+	/* Do not leave the chip in the middle of a cache read sequence. */
+	if (ret)
+		nand->cmdfunc(mtd, NAND_CMD_RESET, -1, -1);
+
+	nand->select_chip(mtd, -1);
+
+	if (!ret && mtd->ecc_stats.failed != stats.failed)
+		ret = -EBADMSG;
+	if (ret)
+		mtd->ecc_stats = stats;
+
+	return ret;
+}
+
+/*
+ * Read data from NAND.
+ *
+ * This function is a veneer that replaces the function originally installed by
+ * the NAND Flash MTD code. Multi-page reads go through the cache read path,
+ * anything else (or anything that fails there) is handed to the original.
+ */
+static int mxs_nand_hook_read(struct mtd_info *mtd, loff_t from, size_t len,
+				size_t *retlen, uint8_t *buf)
+{
+	struct nand_chip *chip = mtd->priv;
+	struct mxs_nand_info *nand_info = chip->priv;
+
+	if (mxs_nand_can_read_cached(mtd, from, len, buf) &&
+	    !mxs_nand_read_cached(mtd, from, len, buf)) {
+		*retlen = len;
+		return 0;
+	}
+
+	return nand_info->hooked_read(mtd, from, len, retlen, buf);
+}
+#endif
+
 /*
  * Read OOB from NAND.
  *
@@ -1005,6 +1229,13 @@ static int mxs_nand_scan_bbt(struct mtd_info *mtd)
 	writel(BCH_CTRL_COMPLETE_IRQ_EN, &bch_regs->hw_bch_ctrl_set);
 
 	/* Hook some operations at the MTD level. */
+#ifdef CONFIG_NAND_MXS_CACHE_READ
+	if (mtd->_read != mxs_nand_hook_read) {
+		nand_info->hooked_read = mtd->_read;
+		mtd->_read = mxs_nand_hook_read;
+	}
+#endif
+
 	if (mtd->_read_oob != mxs_nand_hook_read_oob) {
 		nand_info->hooked_read_oob = mtd->_read_oob;
 		mtd->_read_oob = mxs_nand_hook_read_oob;
@@ -1024,6 +1255,21 @@ static int mxs_nand_scan_bbt(struct mtd_info *mtd)
 	return nand_default_bbt(mtd);
 }
 
+/*
+ * Report how many ECC page reads bypassed the bounce buffer.
+ */
+void mxs_nand_print_stats(struct mtd_info *mtd)
+{
+	struct nand_chip *nand = mtd->priv;
+	struct mxs_nand_info *nand_info = nand->priv;
+
+	printf("  Direct page reads  %8u\n", nand_info->direct_pages);
+	printf("  Bounced page reads %8u\n", nand_info->bounce_pages);
+#ifdef CONFIG_NAND_MXS_CACHE_READ
+	printf("  Cache page reads   %8u\n", nand_info->cache_read_pages);
+#endif
+}
+
 /*
  * Allocate DMA buffers
  */
@@ -51,6 +51,7 @@
 #else
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 #include <common.h>
+#include <hash.h>
 #include <malloc.h>
 #include <watchdog.h>
 #include <linux/err.h>
@@ -1749,6 +1750,7 @@ read_retry:
 			max_bitflips = max_t(unsigned int, max_bitflips,
 					     chip->pagebuf_bitflips);
 		}
+		hash_load_data(buf - bytes, bytes);
 
 		readlen -= bytes;
 
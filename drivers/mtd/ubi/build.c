@@ -1145,6 +1145,11 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
 
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+	/* U-Boot special: run what would have been the thread's job */
+	ubi_wl_flush(ubi, UBI_ALL, UBI_ALL);
+#endif
+
 	/*
 	 * Get a reference to the device in order to prevent 'dev_release()'
 	 * from freeing the @ubi object.
@@ -449,6 +449,9 @@ struct ubi_debug_info {
  * @move_to_put: if the "to" PEB was put
  * @works: list of pending works
  * @works_count: count of pending works
+ * @works_peak: highest number of works pending at the same time
+ * @works_deferred: number of works run after being queued
+ * @works_deferred_ms: total time works spent queued, in milliseconds
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
@@ -553,6 +556,11 @@ struct ubi_device {
 	int move_to_put;
 	struct list_head works;
 	int works_count;
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+	int works_peak;
+	unsigned int works_deferred;
+	unsigned long works_deferred_ms;
+#endif
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
@@ -730,6 +738,9 @@ struct ubi_work {
 	int lnum;
 	int torture;
 	int anchor;
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+	unsigned long queued;
+#endif
 };
 
 #include "debug.h"
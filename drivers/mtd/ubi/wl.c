@@ -207,6 +207,23 @@ static void wl_tree_add(struct ubi_wl_entry *e, struct rb_root *root)
 	rb_insert_color(&e->u.rb, root);
 }
 
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+/**
+ * account_deferred_work - account for the time a work spent queued.
+ * @ubi: UBI device description object
+ * @wrk: the work about to be run
+ */
+static void account_deferred_work(struct ubi_device *ubi,
+				  struct ubi_work *wrk)
+{
+	ubi->works_deferred += 1;
+	ubi->works_deferred_ms += get_timer(wrk->queued);
+}
+#else
+static inline void account_deferred_work(struct ubi_device *ubi,
+					 struct ubi_work *wrk) {}
+#endif
+
 /**
  * do_work - do one pending work.
  * @ubi: UBI device description object
@@ -241,6 +258,8 @@ static int do_work(struct ubi_device *ubi)
 	ubi_assert(ubi->works_count >= 0);
 	spin_unlock(&ubi->wl_lock);
 
+	account_deferred_work(ubi, wrk);
+
 	/*
 	 * Call the worker function. Do not touch the work structure
 	 * after this call as it will have been freed or reused by that
@@ -846,6 +865,17 @@ static void __schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 #ifndef __UBOOT__
 	if (ubi->thread_enabled && !ubi_dbg_is_bgt_disabled(ubi))
 		wake_up_process(ubi->bgt_thread);
+#elif defined(CONFIG_MTD_UBI_DEFER_WORK)
+	/*
+	 * U-Boot special: We have no bgt_thread in U-Boot!
+	 * Leave the work queued, it is run when a free PEB is needed, when
+	 * the queue is flushed, or here once the queue grows too long.
+	 */
+	wrk->queued = get_timer(0);
+	if (ubi->works_count > ubi->works_peak)
+		ubi->works_peak = ubi->works_count;
+	if (ubi->works_count > CONFIG_MTD_UBI_MAX_DEFERRED_WORKS)
+		do_work(ubi);
 #else
 	/*
 	 * U-Boot special: We have no bgt_thread in U-Boot!
@@ -1739,6 +1769,7 @@ int ubi_wl_flush(struct ubi_device *ubi, int vol_id, int lnum)
 				ubi_assert(ubi->works_count >= 0);
 				spin_unlock(&ubi->wl_lock);
 
+				account_deferred_work(ubi, wrk);
 				err = wrk->func(ubi, wrk, 0);
 				if (err) {
 					up_read(&ubi->work_sem);
@@ -1764,6 +1795,29 @@ int ubi_wl_flush(struct ubi_device *ubi, int vol_id, int lnum)
 	return err;
 }
 
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+/**
+ * ubi_flush_deferred_works - run the pending works of all UBI devices.
+ *
+ * U-Boot special: must be called before handing over to an OS, so that no
+ * erasure or wear-leveling work is left behind.
+ */
+void ubi_flush_deferred_works(void)
+{
+	int i, err;
+
+	for (i = 0; i < UBI_MAX_DEVICES; i++) {
+		if (!ubi_devices[i] || !ubi_devices[i]->works_count)
+			continue;
+
+		err = ubi_wl_flush(ubi_devices[i], UBI_ALL, UBI_ALL);
+		if (err)
+			ubi_err("cannot flush pending works of ubi%d, error %d",
+				i, err);
+	}
+}
+#endif
+
 /**
  * tree_destroy - destroy an RB-tree.
  * @root: the root of the tree to destroy
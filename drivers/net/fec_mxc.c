@@ -54,6 +54,10 @@ DECLARE_GLOBAL_DATA_PTR;
 #endif
 
 #define RXDESC_PER_CACHELINE (ARCH_DMA_MINALIGN/sizeof(struct fec_bd))
+#define TXDESC_PER_CACHELINE (ARCH_DMA_MINALIGN/sizeof(struct fec_bd))
+
+/* Size of each driver owned transmit buffer */
+#define FEC_TX_BUF_SIZE	roundup(FEC_MAX_PKT_SIZE, ARCH_DMA_MINALIGN)
 
 /* Check various alignment issues at compile time */
 #if ((ARCH_DMA_MINALIGN < 16) || (ARCH_DMA_MINALIGN % 16 != 0))
@@ -310,6 +314,7 @@ static void fec_rbd_init(struct fec_priv *fec, int count, int dsize)
 	fec->rbd_base[i - 1].status = FEC_RBD_WRAP | FEC_RBD_EMPTY;
 	fec->rbd_index = 0;
 
+	size = roundup(count * sizeof(struct fec_bd), ARCH_DMA_MINALIGN);
 	flush_dcache_range((unsigned)fec->rbd_base,
 			   (unsigned)fec->rbd_base + size);
 }
@@ -318,27 +323,97 @@ static void fec_rbd_init(struct fec_priv *fec, int count, int dsize)
  * Initialize transmit task's buffer descriptors
  * @param[in] fec all we know about the device yet
  *
- * Transmit buffers are created externally. We only have to init the BDs here.\n
+ * Transmit buffers are owned by the driver, one per BD, so fec_send() can
+ * return before the frame has left. We only have to init the BDs here.\n
  * Note: There is a race condition in the hardware. When only one BD is in
  * use it must be marked with the WRAP bit to use it for every transmitt.
  * This bit in combination with the READY bit results into double transmit
  * of each data buffer. It seems the state machine checks READY earlier then
  * resetting it after the first transfer.
- * Using two BDs solves this issue.
+ * Using a ring of several BDs solves this issue.
  */
 static void fec_tbd_init(struct fec_priv *fec)
 {
 	unsigned addr = (unsigned)fec->tbd_base;
-	unsigned size = roundup(2 * sizeof(struct fec_bd),
+	unsigned size = roundup(FEC_TBD_NUM * sizeof(struct fec_bd),
 				ARCH_DMA_MINALIGN);
 
 	memset(fec->tbd_base, 0, size);
-	fec->tbd_base[0].status = 0;
-	fec->tbd_base[1].status = FEC_TBD_WRAP;
+	fec->tbd_base[FEC_TBD_NUM - 1].status = FEC_TBD_WRAP;
 	fec->tbd_index = 0;
+	fec->tbd_clean = 0;
+	fec->tbd_queued = 0;
 	flush_dcache_range(addr, addr + size);
 }
 
+/**
+ * Check whether a queued transmit BD has been sent
+ * @param[in] fec all we know about the device yet
+ * @param[in] index the BD to check
+ * @return 1 if the BD and its buffer may be reused, else 0
+ */
+static int fec_tbd_done(struct fec_priv *fec, int index)
+{
+	struct fec_bd *tbd = &fec->tbd_base[index];
+	uint32_t addr = (uint32_t)tbd & ~(ARCH_DMA_MINALIGN - 1);
+	int last = (fec->tbd_index + FEC_TBD_NUM - 1) % FEC_TBD_NUM;
+
+	invalidate_dcache_range(addr, addr + ARCH_DMA_MINALIGN);
+	if (!(readw(&tbd->status) & FEC_TBD_READY))
+		return 1;
+
+	/*
+	 * Queueing a frame writes back the whole cache line of its BD, so
+	 * the READY bit of a BD sharing that line may be restored right
+	 * after the FEC cleared it. Once TDAR is clear the FEC has sent
+	 * everything though. The last BD is never written back that way,
+	 * so still wait for its READY bit to clear; on mx6solox it clears
+	 * a little after TDAR.
+	 */
+	if (readl(&fec->eth->x_des_active) & FEC_X_DES_ACTIVE_TDAR)
+		return 0;
+
+	return index != last;
+}
+
+/**
+ * Reclaim the transmit BDs the FEC is done with
+ * @param[in] fec all we know about the device yet
+ */
+static void fec_tbd_reclaim(struct fec_priv *fec)
+{
+	while (fec->tbd_queued && fec_tbd_done(fec, fec->tbd_clean)) {
+		fec->tbd_clean = (fec->tbd_clean + 1) % FEC_TBD_NUM;
+		fec->tbd_queued--;
+	}
+}
+
+/**
+ * Wait until all queued frames have been sent
+ * @param[in] fec all we know about the device yet
+ * @return 0 on success, -EINVAL on timeout
+ */
+static int fec_tx_flush(struct fec_priv *fec)
+{
+	int timeout = FEC_XFER_TIMEOUT * FEC_TBD_NUM;
+
+	fec_tbd_reclaim(fec);
+	while (fec->tbd_queued) {
+		if (!--timeout) {
+			printf("fec_mxc: %d frames not sent\n", fec->tbd_queued);
+			return -EINVAL;
+		}
+		fec_tbd_reclaim(fec);
+	}
+
+	return 0;
+}
+
+int fecmxc_flush(struct eth_device *dev)
+{
+	return fec_tx_flush((struct fec_priv *)dev->priv);
+}
+
 /**
  * Mark the given read buffer descriptor as free
  * @param[in] last 1 if this is the last buffer descriptor in the chain, else 0
@@ -540,6 +615,9 @@ static int fec_init(struct eth_device *dev, bd_t* bd)
 
 	/* Setup receive descriptors. */
 	fec_rbd_init(fec, FEC_RBD_NUM, FEC_MAX_PKT_SIZE);
+	fec->rx_frames = 0;
+	fec->rx_dropped = 0;
+	fec->rx_ring_full = 0;
 
 	fec_reg_setup(fec);
 
@@ -587,6 +665,9 @@ static void fec_halt(struct eth_device *dev)
 	struct fec_priv *fec = (struct fec_priv *)dev->priv;
 	int counter = 0xffff;
 
+	/* Let the frames still in the TX ring go out first */
+	fec_tx_flush(fec);
+
 	/*
 	 * issue graceful stop command to the FEC transmitter if necessary
 	 */
@@ -614,6 +695,13 @@ static void fec_halt(struct eth_device *dev)
 			&fec->eth->ecntrl);
 	fec->rbd_index = 0;
 	fec->tbd_index = 0;
+	fec->tbd_clean = 0;
+	fec->tbd_queued = 0;
+
+	if (fec->rx_dropped || fec->rx_ring_full)
+		printf("%s: RX %lu frames, %lu dropped, ring full %lu times\n",
+		       dev->name, fec->rx_frames, fec->rx_dropped,
+		       fec->rx_ring_full);
 	debug("eth_halt: done\n");
 }
 
@@ -627,14 +715,14 @@ static void fec_halt(struct eth_device *dev)
 static int fec_send(struct eth_device *dev, void *packet, int length)
 {
 	unsigned int status;
-	uint32_t size, end;
-	uint32_t addr;
-	int timeout = FEC_XFER_TIMEOUT;
-	int ret = 0;
+	uint32_t size, addr, next_addr;
+	uint8_t *buf;
+	int index, next;
+	int timeout = FEC_XFER_TIMEOUT * FEC_TBD_NUM;
 
 	/*
-	 * This routine transmits one frame.  This routine only accepts
-	 * 6-byte Ethernet addresses.
+	 * This routine queues one frame and returns without waiting for it
+	 * to be sent.  This routine only accepts 6-byte Ethernet addresses.
 	 */
 	struct fec_priv *fec = (struct fec_priv *)dev->priv;
 
@@ -647,21 +735,57 @@ static int fec_send(struct eth_device *dev, void *packet, int length)
 	}
 
 	/*
-	 * Setup the transmit buffer. We are always using the first buffer for
-	 * transmission, the second will be empty and only used to stop the DMA
-	 * engine. We also flush the packet to RAM here to avoid cache trouble.
+	 * Make room in the ring. The cache line following the BD we are
+	 * about to use is written back as well, so it must not hold any BD
+	 * the FEC still owns: keep one cache line worth of BDs free.
 	 */
+	fec_tbd_reclaim(fec);
+	while (fec->tbd_queued >= FEC_TBD_NUM - TXDESC_PER_CACHELINE) {
+		if (!--timeout)
+			return -EINVAL;
+		fec_tbd_reclaim(fec);
+	}
+
+	index = fec->tbd_index;
+	next = (index + 1) % FEC_TBD_NUM;
+
+	/*
+	 * The caller may reuse the packet as soon as we return, so copy it
+	 * to the buffer of this BD and flush it to RAM to avoid cache
+	 * trouble.
+	 */
+	buf = fec->tbd_buf + index * FEC_TX_BUF_SIZE;
+	memcpy(buf, packet, length);
 #ifdef CONFIG_FEC_MXC_SWAP_PACKET
-	swap_packet((uint32_t *)packet, length);
+	swap_packet((uint32_t *)buf, length);
 #endif
+	flush_dcache_range((uint32_t)buf,
+			   (uint32_t)buf + roundup(length, ARCH_DMA_MINALIGN));
 
-	addr = (uint32_t)packet;
-	end = roundup(addr + length, ARCH_DMA_MINALIGN);
-	addr &= ~(ARCH_DMA_MINALIGN - 1);
-	flush_dcache_range(addr, end);
+	/*
+	 * Fetch the cache lines of this and the next BD from RAM first, so
+	 * that writing them back loses as few status updates of the FEC as
+	 * possible (see fec_tbd_done()).
+	 */
+	size = ARCH_DMA_MINALIGN;
+	addr = (uint32_t)&fec->tbd_base[index] & ~(size - 1);
+	next_addr = (uint32_t)&fec->tbd_base[next] & ~(size - 1);
+	invalidate_dcache_range(addr, addr + size);
+	if (next_addr != addr)
+		invalidate_dcache_range(next_addr, next_addr + size);
 
-	writew(length, &fec->tbd_base[fec->tbd_index].data_length);
-	writel(addr, &fec->tbd_base[fec->tbd_index].data_pointer);
+	/*
+	 * The next BD stops the FEC after this frame. Any stale READY bit
+	 * it may carry from an earlier round must be gone before this BD
+	 * becomes ready.
+	 */
+	writew(next == FEC_TBD_NUM - 1 ? FEC_TBD_WRAP : 0,
+	       &fec->tbd_base[next].status);
+	if (next_addr != addr)
+		flush_dcache_range(next_addr, next_addr + size);
+
+	writew(length, &fec->tbd_base[index].data_length);
+	writel((uint32_t)buf, &fec->tbd_base[index].data_pointer);
 
 	/*
 	 * update BD's status now
@@ -671,17 +795,14 @@ static int fec_send(struct eth_device *dev, void *packet, int length)
 	 * - might be the last BD in the list, so the address counter should
 	 *   wrap (-> keep the WRAP flag)
 	 */
-	status = readw(&fec->tbd_base[fec->tbd_index].status) & FEC_TBD_WRAP;
+	status = index == FEC_TBD_NUM - 1 ? FEC_TBD_WRAP : 0;
 	status |= FEC_TBD_LAST | FEC_TBD_TC | FEC_TBD_READY;
-	writew(status, &fec->tbd_base[fec->tbd_index].status);
+	writew(status, &fec->tbd_base[index].status);
 
 	/*
-	 * Flush data cache. This code flushes both TX descriptors to RAM.
-	 * After this code, the descriptors will be safely in RAM and we
-	 * can start DMA.
+	 * Flush data cache. After this code, the descriptor will be safely
+	 * in RAM and we can start DMA.
 	 */
-	size = roundup(2 * sizeof(struct fec_bd), ARCH_DMA_MINALIGN);
-	addr = (uint32_t)fec->tbd_base;
 	flush_dcache_range(addr, addr + size);
 
 	/*
@@ -711,57 +832,12 @@ static int fec_send(struct eth_device *dev, void *packet, int length)
 	 */
 	fec_tx_task_enable(fec);
 
-	/*
-	 * Wait until frame is sent. On each turn of the wait cycle, we must
-	 * invalidate data cache to see what's really in RAM. Also, we need
-	 * barrier here.
-	 */
-	while (--timeout) {
-		if (!(readl(&fec->eth->x_des_active) & FEC_X_DES_ACTIVE_TDAR))
-			break;
-	}
+	debug("fec_send: queued index %d, %d pending\n", index,
+	      fec->tbd_queued + 1);
+	fec->tbd_index = next;
+	fec->tbd_queued++;
 
-	if (!timeout) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	/*
-	 * The TDAR bit is cleared when the descriptors are all out from TX
-	 * but on mx6solox we noticed that the READY bit is still not cleared
-	 * right after TDAR.
-	 * These are two distinct signals, and in IC simulation, we found that
-	 * TDAR always gets cleared prior than the READY bit of last BD becomes
-	 * cleared.
-	 * In mx6solox, we use a later version of FEC IP. It looks like that
-	 * this intrinsic behaviour of TDAR bit has changed in this newer FEC
-	 * version.
-	 *
-	 * Fix this by polling the READY bit of BD after the TDAR polling,
-	 * which covers the mx6solox case and does not harm the other SoCs.
-	 */
-	timeout = FEC_XFER_TIMEOUT;
-	while (--timeout) {
-		invalidate_dcache_range(addr, addr + size);
-		if (!(readw(&fec->tbd_base[fec->tbd_index].status) &
-		    FEC_TBD_READY))
-			break;
-	}
-
-	if (!timeout)
-		ret = -EINVAL;
-
-out:
-	debug("fec_send: status 0x%x index %d ret %i\n",
-			readw(&fec->tbd_base[fec->tbd_index].status),
-			fec->tbd_index, ret);
-	/* for next transmission use the other buffer */
-	if (fec->tbd_index)
-		fec->tbd_index = 0;
-	else
-		fec->tbd_index = 1;
-
-	return ret;
+	return 0;
 }
 
 /**
@@ -779,7 +855,6 @@ static int fec_recv(struct eth_device *dev)
 	uint16_t bd_status;
 	uint32_t addr, size, end;
 	int i;
-	ALLOC_CACHE_ALIGN_BUFFER(uchar, buff, FEC_MAX_PKT_SIZE);
 
 	/*
 	 * Check if any critical events have happened
@@ -846,15 +921,25 @@ static int fec_recv(struct eth_device *dev)
 			invalidate_dcache_range(addr, end);
 
 			/*
-			 *  Fill the buffer and pass it to upper layers
+			 * Pass the buffer to upper layers in place. NetReceive()
+			 * is done with the frame once it returns, so there is
+			 * no need to copy it out of the ring first.
 			 */
 #ifdef CONFIG_FEC_MXC_SWAP_PACKET
 			swap_packet((uint32_t *)frame->data, frame_length);
 #endif
-			memcpy(buff, frame->data, frame_length);
-			NetReceive(buff, frame_length);
+			NetReceive(frame->data, frame_length);
 			len = frame_length;
+			fec->rx_frames++;
+
+			/*
+			 * The stack may have written to the frame (byte swap,
+			 * ICMP echo reply). Discard those lines so they are
+			 * never written back over the next DMA transfer.
+			 */
+			invalidate_dcache_range(addr, end);
 		} else {
+			fec->rx_dropped++;
 			if (bd_status & FEC_RBD_ERR)
 				printf("error frame: 0x%08lx 0x%08x\n",
 						(ulong)rbd->data_pointer,
@@ -879,6 +964,12 @@ static int fec_recv(struct eth_device *dev)
 				addr + ARCH_DMA_MINALIGN);
 		}
 
+		/*
+		 * The receiver clears RDAR when it runs out of empty
+		 * descriptors; any frame arriving meanwhile is lost.
+		 */
+		if (!(readl(&fec->eth->r_des_active) & FEC_R_DES_ACTIVE_RDAR))
+			fec->rx_ring_full++;
 		fec_rx_task_enable(fec);
 		fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
 	}
@@ -898,12 +989,25 @@ static int fec_alloc_descs(struct fec_priv *fec)
 	int i;
 	uint8_t *data;
 
+	/*
+	 * Descriptors are handed back to the FEC one cache line at a time,
+	 * and the TX ring always keeps one cache line of descriptors free.
+	 */
+	BUILD_BUG_ON(FEC_RBD_NUM % RXDESC_PER_CACHELINE);
+	BUILD_BUG_ON(FEC_TBD_NUM < 2 * TXDESC_PER_CACHELINE);
+
 	/* Allocate TX descriptors. */
-	size = roundup(2 * sizeof(struct fec_bd), ARCH_DMA_MINALIGN);
+	size = roundup(FEC_TBD_NUM * sizeof(struct fec_bd), ARCH_DMA_MINALIGN);
 	fec->tbd_base = memalign(ARCH_DMA_MINALIGN, size);
 	if (!fec->tbd_base)
 		goto err_tx;
 
+	/* Allocate TX buffers. */
+	fec->tbd_buf = memalign(ARCH_DMA_MINALIGN,
+				FEC_TBD_NUM * FEC_TX_BUF_SIZE);
+	if (!fec->tbd_buf)
+		goto err_txbuf;
+
 	/* Allocate RX descriptors. */
 	size = roundup(FEC_RBD_NUM * sizeof(struct fec_bd), ARCH_DMA_MINALIGN);
 	fec->rbd_base = memalign(ARCH_DMA_MINALIGN, size);
@@ -945,6 +1049,8 @@ err_ring:
 		free((void *)fec->rbd_base[i].data_pointer);
 	free(fec->rbd_base);
 err_rx:
+	free(fec->tbd_buf);
+err_txbuf:
 	free(fec->tbd_base);
 err_tx:
 	return -ENOMEM;
@@ -957,6 +1063,7 @@ static void fec_free_descs(struct fec_priv *fec)
 	for (i = 0; i < FEC_RBD_NUM; i++)
 		free((void *)fec->rbd_base[i].data_pointer);
 	free(fec->rbd_base);
+	free(fec->tbd_buf);
 	free(fec->tbd_base);
 }
 
@@ -254,10 +254,15 @@ struct fec_priv {
 	int rbd_index;			/* next receive BD to read */
 	struct fec_bd *tbd_base;	/* TBD ring */
 	int tbd_index;			/* next transmit BD to write */
+	int tbd_clean;			/* oldest transmit BD not reclaimed */
+	int tbd_queued;			/* transmit BDs not reclaimed */
+	uint8_t *tbd_buf;		/* transmit buffers, one per TBD */
 	bd_t *bd;
-	uint8_t *tdb_ptr;
 	int dev_id;
 	struct mii_dev *bus;
+	unsigned long rx_frames;	/* frames passed to the stack */
+	unsigned long rx_dropped;	/* bad or runt frames discarded */
+	unsigned long rx_ring_full;	/* receiver stalled on a full ring */
 #ifdef CONFIG_PHYLIB
 	struct phy_device *phydev;
 #else
@@ -270,9 +275,27 @@ struct fec_priv {
  * @brief Numbers of buffer descriptors for receiving
  *
  * The number defines the stocked memory buffers for the receiving task.
- * Larger values makes no sense in this limited environment.
+ * Boards which see bursts of frames (e.g. TFTP with a large window) can
+ * raise it with CONFIG_FEC_MXC_RBD_NUM. It must be a multiple of the
+ * number of descriptors sharing one cache line.
  */
+#ifdef CONFIG_FEC_MXC_RBD_NUM
+#define FEC_RBD_NUM		CONFIG_FEC_MXC_RBD_NUM
+#else
 #define FEC_RBD_NUM		64
+#endif
+
+/**
+ * @brief Numbers of buffer descriptors for transmitting
+ *
+ * fec_send() queues frames in this ring and returns without waiting for
+ * them to be sent. One cache line worth of descriptors always stays free.
+ */
+#ifdef CONFIG_FEC_MXC_TBD_NUM
+#define FEC_TBD_NUM		CONFIG_FEC_MXC_TBD_NUM
+#else
+#define FEC_TBD_NUM		16
+#endif
 
 /**
  * @brief Define the ethernet packet size limit in memory
@@ -1496,6 +1496,77 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/*
+ * Find the run of blocks 'fileblock' is in, in a file that uses extents:
+ * the extent itself, or the hole up to the next one.
+ */
+static int ext4fs_find_extent(struct ext2_inode *inode, uint32_t fileblock,
+			      struct ext4_extent_cache *run)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t block, len;
+	int blksz, log2_blksz;
+	int entries, i, uninit;
+	char *buf;
+
+	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+
+	buf = zalloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, buf,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		free(buf);
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+	entries = le16_to_cpu(ext_block->eh_entries);
+	for (i = 0; i < entries; i++)
+		if (fileblock < le32_to_cpu(extent[i].ee_block))
+			break;
+
+	/* A hole, unless the extent before covers 'fileblock' */
+	run->block = fileblock;
+	run->start = 0;
+	run->uninit = 0;
+	if (i > 0) {
+		struct ext4_extent *prev = &extent[i - 1];
+
+		block = le32_to_cpu(prev->ee_block);
+		len = le16_to_cpu(prev->ee_len);
+		uninit = len > EXT_INIT_MAX_LEN;
+		if (uninit)
+			len -= EXT_INIT_MAX_LEN;
+		if (fileblock - block < len) {
+			run->block = block;
+			run->len = len;
+			run->start = le16_to_cpu(prev->ee_start_hi);
+			run->start = (run->start << 32) +
+				le32_to_cpu(prev->ee_start_lo);
+			run->uninit = uninit;
+			free(buf);
+			return 0;
+		}
+		run->block = block + len;
+	}
+	/* The hole ends where the next extent starts, if it is in this leaf */
+	if (i < entries)
+		run->len = le32_to_cpu(extent[i].ee_block) - run->block;
+	else
+		run->len = fileblock + 1 - run->block;
+
+	free(buf);
+	return 0;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 {
 	long int blknr;
@@ -1505,54 +1576,21 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i = -1;
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			free(buf);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
+		struct ext4_extent_cache run;
 
-		do {
-			i++;
-			if (i >= le16_to_cpu(ext_block->eh_entries))
-				break;
-		} while (fileblock >= le32_to_cpu(extent[i].ee_block));
-		if (--i >= 0) {
-			fileblock -= le32_to_cpu(extent[i].ee_block);
-			if (fileblock >= le16_to_cpu(extent[i].ee_len)) {
-				free(buf);
-				return 0;
-			}
-
-			start = le16_to_cpu(extent[i].ee_start_hi);
-			start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-			free(buf);
-			return fileblock + start;
-		}
+		status = ext4fs_find_extent(inode, fileblock, &run);
+		if (status)
+			return status;
+		if (!run.start)
+			return 0;
 
-		printf("Extent Error\n");
-		free(buf);
-		return -1;
+		return run.start + fileblock - run.block;
 	}
 
 	/* Direct blocks. */
@@ -1840,6 +1878,40 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	return blknr;
 }
 
+/*
+ * Map 'fileblock' of 'node' like read_allocated_block() does, and return
+ * in *len how many blocks from it on follow it on disk, or are part of the
+ * same hole if it returns 0. Each extent is looked up in the tree once and
+ * kept in the node, so reading a file walks the tree once per extent, not
+ * once per block. For reading only: an uninitialized extent is returned as
+ * a hole, as its blocks hold no data yet.
+ */
+long int read_allocated_run(struct ext2fs_node *node, int fileblock, int *len)
+{
+	struct ext4_extent_cache *run = &node->extent;
+	uint32_t off;
+
+	if (!(le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL)) {
+		*len = 1;
+		return read_allocated_block(&node->inode, fileblock);
+	}
+
+	off = (uint32_t)fileblock - run->block;
+	if (off >= run->len) {
+		if (ext4fs_find_extent(&node->inode, fileblock, run)) {
+			run->len = 0;
+			return -1;
+		}
+		off = fileblock - run->block;
+	}
+
+	*len = run->len - off;
+	if (!run->start || run->uninit)
+		return 0;
+
+	return run->start + off;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2233,6 +2305,8 @@ int ext4fs_mount(unsigned part_length)
 	data->diropen.data = data;
 	data->diropen.ino = 2;
 	data->diropen.inode_read = 1;
+	/* Reading the superblock has left its tail here */
+	memset(&data->diropen.extent, '\0', sizeof(data->diropen.extent));
 	data->inode = &data->diropen.inode;
 
 	status = ext4fs_read_inode(data, 2, data->inode);
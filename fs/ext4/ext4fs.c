@@ -45,12 +45,16 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
  * reads into one potentially more efficient larger sequential read action
+ *
+ * The file is walked a run of blocks at a time, as read_allocated_run()
+ * finds them, so a file made of a few extents costs a few lookups and
+ * reads however many blocks it has.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
+	int i, first, run;
 	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
@@ -69,63 +73,52 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		len = filesize;
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
+	first = lldiv(pos, blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	for (i = first; i < blockcnt; i += run) {
 		lbaint_t blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
 		int skipfirst = 0;
-		blknr = read_allocated_block(&(node->inode), i);
+		int bytes;
+
+		blknr = read_allocated_run(node, i, &run);
 		if (blknr < 0)
 			return -1;
 
 		blknr = blknr << log2_fs_blocksize;
+		if (run > blockcnt - i)
+			run = blockcnt - i;
+		bytes = run * blocksize;
 
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
+		/* Last block: may end short of the block size */
+		if (i + run == blockcnt)
+			bytes -= blocksize * blockcnt - (len + pos);
 
 		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
+		if (i == first) {
+			skipfirst = pos - (blocksize * i);
+			bytes -= skipfirst;
 		}
 		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
+			if (previous_block_number != -1 &&
+			    delayed_next == blknr) {
+				delayed_extent += bytes;
+			} else {
+				if (previous_block_number != -1) {
+					/* spill */
 					status = ext4fs_devread(delayed_start,
 							delayed_skipfirst,
 							delayed_extent,
 							delayed_buf);
 					if (status == 0)
 						return -1;
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
 				}
-			} else {
 				previous_block_number = blknr;
 				delayed_start = blknr;
-				delayed_extent = blockend;
+				delayed_extent = bytes;
 				delayed_skipfirst = skipfirst;
 				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
 			}
+			delayed_next = blknr + (run << log2_fs_blocksize);
 		} else {
 			if (previous_block_number != -1) {
 				/* spill */
@@ -137,9 +130,9 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					return -1;
 				previous_block_number = -1;
 			}
-			memset(buf, 0, blocksize - skipfirst);
+			memset(buf, 0, bytes);
 		}
-		buf += blocksize - skipfirst;
+		buf += bytes;
 	}
 	if (previous_block_number != -1) {
 		/* spill */
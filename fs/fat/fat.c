@@ -42,6 +42,48 @@ static disk_partition_t cur_part_info;
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
+#define DOS_BPB_LEN		0x5a	/* Boot sector up to the FAT32 type */
+
+/* The volume on cur_dev, as set up by fat_mount() */
+static struct {
+	int mounted;
+	fsdata data;
+	__u32 root_cluster;
+	int rootdir_size;
+#ifdef CONFIG_FS_FAT_MOUNT_CACHE
+	__u8 bpb[DOS_BPB_LEN];	/* Boot sector seen by fat_set_blk_dev() */
+	int dent_next;		/* Slot in dent[] to replace next */
+	struct {
+		char name[DENT_CACHE_NAMELEN];
+		dir_entry dent;
+	} dent[CONFIG_FS_FAT_DENT_CACHE];
+#endif
+} mnt;
+
+static void fat_umount(void)
+{
+	if (!mnt.mounted)
+		return;
+
+	free(mnt.data.fatcache);
+	mnt.data.fatcache = NULL;
+	mnt.mounted = 0;
+#ifdef CONFIG_FS_FAT_MOUNT_CACHE
+	memset(mnt.dent, 0, sizeof(mnt.dent));
+	mnt.dent_next = 0;
+#endif
+}
+
+#if defined(CONFIG_FS_FAT_MOUNT_CACHE) && !defined(CONFIG_SPL_BUILD)
+/*
+ * Forget the mounted volume, for when it has been written to behind
+ * the back of this file, or the medium may have changed.
+ */
+void fat_invalidate(void)
+{
+	fat_umount();
+}
+#endif
 
 static int disk_read(__u32 block, __u32 nr_blocks, void *buf)
 {
@@ -56,28 +98,38 @@ int fat_set_blk_dev(block_dev_desc_t *dev_desc, disk_partition_t *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* Another device or partition is another volume */
+	if (dev_desc != cur_dev || info->start != cur_part_info.start)
+		fat_umount();
+
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
 	/* Make sure it has a valid FAT header */
-	if (disk_read(0, 1, buffer) != 1) {
-		cur_dev = NULL;
-		return -1;
-	}
+	if (disk_read(0, 1, buffer) != 1)
+		goto fail;
 
 	/* Check if it's actually a DOS volume */
-	if (memcmp(buffer + DOS_BOOT_MAGIC_OFFSET, "\x55\xAA", 2)) {
-		cur_dev = NULL;
-		return -1;
-	}
+	if (memcmp(buffer + DOS_BOOT_MAGIC_OFFSET, "\x55\xAA", 2))
+		goto fail;
 
 	/* Check for FAT12/FAT16/FAT32 filesystem */
-	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3))
-		return 0;
-	if (!memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5))
-		return 0;
+	if (memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3) &&
+	    memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5))
+		goto fail;
 
+#ifdef CONFIG_FS_FAT_MOUNT_CACHE
+	/* The medium may have been changed or reformatted since */
+	if (memcmp(buffer, mnt.bpb, DOS_BPB_LEN)) {
+		fat_umount();
+		memcpy(mnt.bpb, buffer, DOS_BPB_LEN);
+	}
+#endif
+	return 0;
+
+fail:
 	cur_dev = NULL;
+	fat_umount();
 	return -1;
 }
 
@@ -155,98 +207,123 @@ static void get_name(dir_entry *dirent, char *s_name)
 }
 
 /*
- * Get the entry at index 'entry' in a FAT (12/16/32) table.
- * On failure 0x00 is returned.
+ * Set up the FAT cache: as many windows as it takes to hold the whole FAT,
+ * if that is no more than CONFIG_FS_FAT_CACHE_WINDOWS of them.
+ * Return 0 on success, -1 otherwise.
  */
-static __u32 get_fatent(fsdata *mydata, __u32 entry)
+static int fat_cache_init(fsdata *mydata)
 {
-	__u32 bufnum;
-	__u32 off16, offset;
-	__u32 ret = 0x00;
-	__u16 val1, val2;
-
-	switch (mydata->fatsize) {
-	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
-		break;
-	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
-		break;
-	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
-		break;
+	__u32 nwins = DIV_ROUND_UP(mydata->fatlength,
+				   CONFIG_FS_FAT_CACHE_BLOCKS);
+	int i;
 
-	default:
-		/* Unsupported FAT size */
-		return ret;
-	}
+	if (nwins > CONFIG_FS_FAT_CACHE_WINDOWS)
+		nwins = CONFIG_FS_FAT_CACHE_WINDOWS;
 
-	debug("FAT%d: entry: 0x%04x = %d, offset: 0x%04x = %d\n",
-	       mydata->fatsize, entry, entry, offset, offset);
+	mydata->fatcache = memalign(ARCH_DMA_MINALIGN, nwins *
+				    CONFIG_FS_FAT_CACHE_BLOCKS *
+				    mydata->sect_size);
+	if (mydata->fatcache == NULL)
+		return -1;
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+	mydata->fatcache_wins = nwins;
+	mydata->fatcache_last = 0;
+	mydata->fatcache_clock = 0;
+	for (i = 0; i < nwins; i++) {
+		mydata->fatwin[i].num = -1;
+		mydata->fatwin[i].used = 0;
+	}
 
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
+	return 0;
+}
 
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
+/*
+ * Return a pointer to byte 'off' of the FAT, reading the window it is in
+ * over the one used least recently if it is not in the cache.
+ * On failure NULL is returned.
+ */
+static __u8 *fat_cache_get(fsdata *mydata, __u32 off)
+{
+	__u32 winsize = CONFIG_FS_FAT_CACHE_BLOCKS * mydata->sect_size;
+	__u32 num = off / winsize;
+	__u32 startblock, getsize;
+	int i, w = mydata->fatcache_last;
+
+	if (mydata->fatwin[w].num != num) {
+		for (i = 0; i < mydata->fatcache_wins; i++) {
+			if (mydata->fatwin[i].num == num)
+				break;
+			if (mydata->fatwin[i].used < mydata->fatwin[w].used)
+				w = i;
+		}
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
+		if (i < mydata->fatcache_wins) {
+			w = i;
+		} else {
+			startblock = num * CONFIG_FS_FAT_CACHE_BLOCKS;
+			if (startblock >= mydata->fatlength)
+				return NULL;
+			getsize = min((__u32)CONFIG_FS_FAT_CACHE_BLOCKS,
+				      mydata->fatlength - startblock);
+
+			debug("FAT window %u -> %d\n", num, w);
+			mydata->fatwin[w].num = -1;
+			if (disk_read(mydata->fat_sect + startblock, getsize,
+				      mydata->fatcache + w * winsize) < 0) {
+				debug("Error reading FAT blocks\n");
+				return NULL;
+			}
+			mydata->fatwin[w].num = num;
 		}
-		mydata->fatbufnum = bufnum;
+		mydata->fatcache_last = w;
 	}
+	mydata->fatwin[w].used = ++mydata->fatcache_clock;
+
+	return mydata->fatcache + w * winsize + off % winsize;
+}
+
+/*
+ * Get the entry at index 'entry' in a FAT (12/16/32) table.
+ * On failure 0x00 is returned.
+ */
+static __u32 get_fatent(fsdata *mydata, __u32 entry)
+{
+	__u8 *p, *p2;
+	__u32 ret = 0x00;
 
-	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		p = fat_cache_get(mydata, entry * 4);
+		if (p)
+			ret = FAT2CPU32(*(__u32 *)p);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		p = fat_cache_get(mydata, entry * 2);
+		if (p)
+			ret = FAT2CPU16(*(__u16 *)p);
 		break;
 	case 12:
-		off16 = (offset * 3) / 4;
-
-		switch (offset & 0x3) {
-		case 0:
-			ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[off16]);
-			ret &= 0xfff;
-			break;
-		case 1:
-			val1 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
-			val1 &= 0xf000;
-			val2 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16 + 1]);
-			val2 &= 0x00ff;
-			ret = (val2 << 4) | (val1 >> 12);
-			break;
-		case 2:
-			val1 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
-			val1 &= 0xff00;
-			val2 = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16 + 1]);
-			val2 &= 0x000f;
-			ret = (val2 << 8) | (val1 >> 8);
-			break;
-		case 3:
-			ret = FAT2CPU16(((__u16 *)mydata->fatbuf)[off16]);
-			ret = (ret & 0xfff0) >> 4;
+		/* Entries are 1.5 bytes, and may span two windows */
+		p = fat_cache_get(mydata, entry * 3 / 2);
+		if (!p)
 			break;
-		default:
-			break;
-		}
+		ret = *p;
+		p2 = fat_cache_get(mydata, entry * 3 / 2 + 1);
+		if (!p2)
+			return 0x00;
+		ret |= *p2 << 8;
+		if (entry & 1)
+			ret >>= 4;
+		else
+			ret &= 0xfff;
+		break;
+	default:
+		/* Unsupported FAT size */
 		break;
 	}
-	debug("FAT%d: ret: %08x, offset: %04x\n",
-	       mydata->fatsize, ret, offset);
+
+	debug("FAT%d: entry: 0x%04x = %d, ret: %08x\n",
+	      mydata->fatsize, entry, entry, ret);
 
 	return ret;
 }
@@ -314,6 +391,29 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Find how many of the clusters from 'clust' on follow each other on disk,
+ * counting no more than it takes to cover 'size' bytes. Return the bytes
+ * they hold; the cluster the chain goes on with is stored in *next.
+ */
+static loff_t get_run(fsdata *mydata, __u32 clust, loff_t size, __u32 *next)
+{
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	loff_t len = bytesperclust;
+	__u32 newclust;
+
+	newclust = get_fatent(mydata, clust);
+	while (len < size && newclust == clust + 1 &&
+	       !CHECK_CLUST(newclust, mydata->fatsize)) {
+		clust = newclust;
+		len += bytesperclust;
+		newclust = get_fatent(mydata, clust);
+	}
+	*next = newclust;
+
+	return len;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -328,7 +428,7 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	__u32 newclust;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -386,50 +486,28 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+	/* Read the rest a run of consecutive clusters at a time */
+	while (1) {
+		actsize = get_run(mydata, curclust, filesize, &newclust);
+		if (actsize > filesize)
+			actsize = filesize;
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
+		if (!filesize)
+			return 0;
 		buffer += actsize;
 
-		curclust = get_fatent(mydata, endclust);
+		curclust = newclust;
 		if (CHECK_CLUST(curclust, mydata->fatsize)) {
 			debug("curclust: 0x%x\n", curclust);
 			printf("Invalid FAT entry\n");
 			return 0;
 		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	}
 }
 
 /*
@@ -806,36 +884,25 @@ exit:
 __u8 do_fat_read_at_block[MAX_CLUSTSIZE]
 	__aligned(ARCH_DMA_MINALIGN);
 
-int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
-		   loff_t maxsize, int dols, int dogetsize, loff_t *size)
+/*
+ * Read the boot sector of the volume on cur_dev and set up 'mnt' for it.
+ * Return 0 on success, -1 otherwise.
+ */
+static int fat_mount(void)
 {
-	char fnamecopy[2048];
 	boot_sector bs;
 	volume_info volinfo;
-	fsdata datablock;
-	fsdata *mydata = &datablock;
-	dir_entry *dentptr = NULL;
-	__u16 prevcksum = 0xffff;
-	char *subname = "";
-	__u32 cursect;
-	int idx, isdir = 0;
-	int files = 0, dirs = 0;
-	int ret = -1;
-	int firsttime;
-	__u32 root_cluster = 0;
-	__u32 read_blk;
-	int rootdir_size = 0;
-	int buffer_blk_cnt;
-	int do_read;
-	__u8 *dir_ptr;
+	fsdata *mydata = &mnt.data;
 
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
 		debug("Error: reading boot sector\n");
 		return -1;
 	}
 
+	mnt.root_cluster = 0;
+	mnt.rootdir_size = 0;
 	if (mydata->fatsize == 32) {
-		root_cluster = bs.root_cluster;
+		mnt.root_cluster = bs.root_cluster;
 		mydata->fatlength = bs.fat32_length;
 	} else {
 		mydata->fatlength = bs.fat_length;
@@ -843,8 +910,7 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 
 	mydata->fat_sect = bs.reserved;
 
-	cursect = mydata->rootdir_sect
-		= mydata->fat_sect + mydata->fatlength * bs.fats;
+	mydata->rootdir_sect = mydata->fat_sect + mydata->fatlength * bs.fats;
 
 	mydata->sect_size = (bs.sector_size[1] << 8) + bs.sector_size[0];
 	mydata->clust_size = bs.cluster_size;
@@ -858,18 +924,16 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 		mydata->data_begin = mydata->rootdir_sect -
 					(mydata->clust_size * 2);
 	} else {
-		rootdir_size = ((bs.dir_entries[1]  * (int)256 +
-				 bs.dir_entries[0]) *
-				 sizeof(dir_entry)) /
-				 mydata->sect_size;
+		mnt.rootdir_size = ((bs.dir_entries[1]  * (int)256 +
+				     bs.dir_entries[0]) *
+				     sizeof(dir_entry)) /
+				     mydata->sect_size;
 		mydata->data_begin = mydata->rootdir_sect +
-					rootdir_size -
+					mnt.rootdir_size -
 					(mydata->clust_size * 2);
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
+	if (fat_cache_init(mydata)) {
 		debug("Error: allocating memory\n");
 		return -1;
 	}
@@ -881,12 +945,88 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	       mydata->fatsize, mydata->fat_sect, mydata->fatlength);
 	debug("Rootdir begins at cluster: %d, sector: %d, offset: %x\n"
 	       "Data begins at: %d\n",
-	       root_cluster,
+	       mnt.root_cluster,
 	       mydata->rootdir_sect,
 	       mydata->rootdir_sect * mydata->sect_size, mydata->data_begin);
 	debug("Sector size: %d, cluster size: %d\n", mydata->sect_size,
 	      mydata->clust_size);
 
+	mnt.mounted = 1;
+
+	return 0;
+}
+
+#ifdef CONFIG_FS_FAT_MOUNT_CACHE
+/*
+ * Look 'path' up among the directory entries found before, and copy its
+ * entry into 'dent'. Return 1 if it is there, 0 otherwise.
+ */
+static int dent_cache_lookup(const char *path, dir_entry *dent)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_FS_FAT_DENT_CACHE; i++) {
+		if (mnt.dent[i].name[0] && !strcmp(mnt.dent[i].name, path)) {
+			*dent = mnt.dent[i].dent;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Remember the entry found for 'path', over the oldest one */
+static void dent_cache_add(const char *path, const dir_entry *dent)
+{
+	int i = mnt.dent_next;
+
+	if (strlen(path) >= DENT_CACHE_NAMELEN)
+		return;
+
+	strcpy(mnt.dent[i].name, path);
+	downcase(mnt.dent[i].name);
+	mnt.dent[i].dent = *dent;
+	mnt.dent_next = (i + 1) % CONFIG_FS_FAT_DENT_CACHE;
+}
+#else
+static inline int dent_cache_lookup(const char *path, dir_entry *dent)
+{
+	return 0;
+}
+
+static inline void dent_cache_add(const char *path, const dir_entry *dent)
+{
+}
+#endif
+
+int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
+		   loff_t maxsize, int dols, int dogetsize, loff_t *size)
+{
+	char fnamecopy[2048];
+	fsdata *mydata = &mnt.data;
+	dir_entry cached;
+	dir_entry *dentptr = NULL;
+	__u16 prevcksum = 0xffff;
+	char *subname = "";
+	__u32 cursect;
+	int idx, isdir = 0;
+	int files = 0, dirs = 0;
+	int ret = -1;
+	int firsttime;
+	__u32 root_cluster = 0;
+	__u32 read_blk;
+	int rootdir_size = 0;
+	int buffer_blk_cnt;
+	int do_read;
+	__u8 *dir_ptr;
+
+	if (!mnt.mounted && fat_mount())
+		return -1;
+
+	root_cluster = mnt.root_cluster;
+	rootdir_size = mnt.rootdir_size;
+	cursect = mydata->rootdir_sect;
+
 	/* "cwd" is always the root... */
 	while (ISDIRDELIM(*filename))
 		filename++;
@@ -895,6 +1035,11 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	strcpy(fnamecopy, filename);
 	downcase(fnamecopy);
 
+	if (!dols && dent_cache_lookup(fnamecopy, &cached)) {
+		dentptr = &cached;
+		goto found;
+	}
+
 	if (*fnamecopy == '\0') {
 		if (!dols)
 			goto exit;
@@ -1184,6 +1329,9 @@ rootdir_done:
 			subname = nextname;
 	}
 
+	if (!dols)
+		dent_cache_add(filename, dentptr);
+found:
 	if (dogetsize) {
 		*size = FAT2CPU32(dentptr->size);
 		ret = 0;
@@ -1193,7 +1341,9 @@ rootdir_done:
 	debug("Size: %u, got: %llu\n", FAT2CPU32(dentptr->size), *size);
 
 exit:
-	free(mydata->fatbuf);
+#ifndef CONFIG_FS_FAT_MOUNT_CACHE
+	fat_umount();
+#endif
 	return ret;
 }
 
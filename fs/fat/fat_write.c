@@ -944,6 +944,9 @@ static int do_fat_write(const char *filename, void *buffer, loff_t size,
 	*actwrite = size;
 	dir_curclust = 0;
 
+	/* What was read of the volume before is about to be out of date */
+	fat_umount();
+
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
 		debug("error: reading boot sector\n");
 		return -1;
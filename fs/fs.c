@@ -21,6 +21,7 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <hash.h>
 #include <sandboxfs.h>
 #include <asm/io.h>
 #include <div64.h>
@@ -296,7 +297,10 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	hash_load_start(buf);
 	ret = info->read(filename, buf, offset, len, actread);
+	if (!ret)
+		hash_load_end(buf, *actread);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
@@ -24,6 +24,7 @@
  */
 
 #include "ubifs.h"
+#include <hash.h>
 #include <u-boot/zlib.h>
 
 #include <linux/err.h>
@@ -622,27 +623,19 @@ out:
 
 /* file.c */
 
-static inline void *kmap(struct page *page)
-{
-	return page->addr;
-}
-
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+/*
+ * Decompress data node 'dn' of 'block' to 'addr', where there is room for
+ * 'room' bytes: a whole block, or what is left of the load at its last
+ * block. Only when the data does not fit is it decompressed to 'tail',
+ * of UBIFS_BLOCK_SIZE bytes, and the part that fits copied from there.
+ */
+static int read_data_node(struct ubifs_info *c, struct inode *inode,
+			  struct ubifs_data_node *dn, unsigned int block,
+			  void *addr, int room, void *tail)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
-
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
+	void *out = addr;
 
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
@@ -651,19 +644,23 @@ static int read_block(struct inode *inode, void *addr, unsigned int block,
 		goto dump;
 
 	dlen = le32_to_cpu(dn->ch.len) - UBIFS_DATA_NODE_SZ;
-	out_len = UBIFS_BLOCK_SIZE;
-	err = ubifs_decompress(&dn->data, dlen, addr, &out_len,
+	if (len > room || dlen > room)
+		out = tail;
+	out_len = out == tail ? UBIFS_BLOCK_SIZE : room;
+	err = ubifs_decompress(&dn->data, dlen, out, &out_len,
 			       le16_to_cpu(dn->compr_type));
 	if (err || len != out_len)
 		goto dump;
 
+	if (out == tail)
+		memcpy(addr, tail, room);
 	/*
 	 * Data length can be less than a full block, even for blocks that are
 	 * not the last in the file (e.g., as a result of making a hole and
 	 * appending data). Ensure that the remainder is zeroed out.
 	 */
-	if (len < UBIFS_BLOCK_SIZE)
-		memset(addr + len, 0, UBIFS_BLOCK_SIZE - len);
+	else if (len < room)
+		memset(addr + len, 0, room - len);
 
 	return 0;
 
@@ -674,115 +671,54 @@ dump:
 	return -EINVAL;
 }
 
-static int do_readpage(struct ubifs_info *c, struct inode *inode,
-		       struct page *page, int last_block_size)
+/*
+ * Load blocks of 'inode' from 'block' on to 'addr', 'size' bytes at most,
+ * reading the data nodes that follow each other in a LEB, up to the size
+ * of @bu->buf, in one go. Holes are zero-filled. Returns the number of
+ * blocks loaded, or a negative error code.
+ */
+static int do_bulk_read(struct ubifs_info *c, struct inode *inode,
+			struct bu_info *bu, unsigned int block, void *addr,
+			u32 size, void *tail)
 {
-	void *addr;
-	int err = 0, i;
-	unsigned int block, beyond;
-	struct ubifs_data_node *dn;
-	loff_t i_size = inode->i_size;
-
-	dbg_gen("ino %lu, pg %lu, i_size %lld",
-		inode->i_ino, page->index, i_size);
-
-	addr = kmap(page);
-
-	block = page->index << UBIFS_BLOCKS_PER_PAGE_SHIFT;
-	beyond = (i_size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
-	if (block >= beyond) {
-		/* Reading beyond inode */
-		memset(addr, 0, PAGE_CACHE_SIZE);
-		goto out;
-	}
+	unsigned int i, n, nblocks, next = 0;
+	void *buf = bu->buf;
+	int err, room;
 
-	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
-	if (!dn)
-		return -ENOMEM;
+	data_key_init(c, &bu->key, inode->i_ino, block);
+	err = ubifs_tnc_get_bu_keys(c, bu);
+	if (err)
+		return err;
 
-	i = 0;
-	while (1) {
-		int ret;
+	if (bu->cnt) {
+		err = ubifs_tnc_bulk_read(c, bu);
+		if (err)
+			return err;
+	}
 
-		if (block >= beyond) {
-			/* Reading beyond inode */
-			err = -ENOENT;
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
+	nblocks = (size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
+	/* There is no data past the last node found, only holes */
+	n = bu->eof ? nblocks : min_t(unsigned int, bu->blk_cnt, nblocks);
+
+	for (i = 0; i < n; i++) {
+		room = min_t(u32, size, UBIFS_BLOCK_SIZE);
+		if (next < bu->cnt &&
+		    key_block(c, &bu->zbranch[next].key) == block + i) {
+			err = read_data_node(c, inode, buf, block + i, addr,
+					     room, tail);
+			if (err)
+				return err;
+			buf += ALIGN(bu->zbranch[next].len, 8);
+			next++;
 		} else {
-			/*
-			 * Reading last block? Make sure to not write beyond
-			 * the requested size in the destination buffer.
-			 */
-			if (((block + 1) == beyond) || last_block_size) {
-				void *buff;
-				int dlen;
-
-				/*
-				 * We need to buffer the data locally for the
-				 * last block. This is to not pad the
-				 * destination area to a multiple of
-				 * UBIFS_BLOCK_SIZE.
-				 */
-				buff = malloc(UBIFS_BLOCK_SIZE);
-				if (!buff) {
-					printf("%s: Error, malloc fails!\n",
-					       __func__);
-					err = -ENOMEM;
-					break;
-				}
-
-				/* Read block-size into temp buffer */
-				ret = read_block(inode, buff, block, dn);
-				if (ret) {
-					err = ret;
-					if (err != -ENOENT) {
-						free(buff);
-						break;
-					}
-				}
-
-				if (last_block_size)
-					dlen = last_block_size;
-				else
-					dlen = le32_to_cpu(dn->size);
-
-				/* Now copy required size back to dest */
-				memcpy(addr, buff, dlen);
-
-				free(buff);
-			} else {
-				ret = read_block(inode, addr, block, dn);
-				if (ret) {
-					err = ret;
-					if (err != -ENOENT)
-						break;
-				}
-			}
-		}
-		if (++i >= UBIFS_BLOCKS_PER_PAGE)
-			break;
-		block += 1;
-		addr += UBIFS_BLOCK_SIZE;
-	}
-	if (err) {
-		if (err == -ENOENT) {
-			/* Not found, so it must be a hole */
 			dbg_gen("hole");
-			goto out_free;
+			memset(addr, 0, room);
 		}
-		ubifs_err("cannot read page %lu of inode %lu, error %d",
-			  page->index, inode->i_ino, err);
-		goto error;
+		addr += room;
+		size -= room;
 	}
 
-out_free:
-	kfree(dn);
-out:
-	return 0;
-
-error:
-	kfree(dn);
-	return err;
+	return n;
 }
 
 int ubifs_load(char *filename, u32 addr, u32 size)
@@ -790,11 +726,11 @@ int ubifs_load(char *filename, u32 addr, u32 size)
 	struct ubifs_info *c = ubifs_sb->s_fs_info;
 	unsigned long inum;
 	struct inode *inode;
-	struct page page;
-	int err = 0;
-	int i;
-	int count;
-	int last_block_size = 0;
+	struct bu_info *bu;
+	void *tail;
+	unsigned int block;
+	u32 done, len;
+	int err = 0, n;
 
 	c->ubi = ubi_open_volume(c->vi.ubi_num, c->vi.vol_id, UBI_READONLY);
 	/* ubifs_findfile will resolve symlinks, so we know that we get
@@ -822,35 +758,57 @@ int ubifs_load(char *filename, u32 addr, u32 size)
 	if ((size == 0) || (size > inode->i_size))
 		size = inode->i_size;
 
-	count = (size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
+	/*
+	 * Data nodes are bulk-read into a buffer of up to a LEB, and
+	 * decompressed from there. If that much memory cannot be had, one
+	 * node at a time is read.
+	 */
+	bu = malloc(sizeof(*bu));
+	if (bu) {
+		bu->buf_len = c->max_bu_buf_len;
+		bu->buf = malloc(bu->buf_len + UBIFS_BLOCK_SIZE);
+		if (!bu->buf) {
+			bu->buf_len = UBIFS_MAX_DATA_NODE_SZ;
+			bu->buf = malloc(bu->buf_len + UBIFS_BLOCK_SIZE);
+		}
+	}
+	if (!bu || !bu->buf) {
+		printf("%s: Error, malloc fails!\n", __func__);
+		err = -ENOMEM;
+		goto out_inode;
+	}
+	/* Room for the last block, when it is not loaded whole */
+	tail = bu->buf + bu->buf_len;
+
 	printf("Loading file '%s' to addr 0x%08x with size %d (0x%08x)...\n",
 	       filename, addr, size, size);
 
-	page.addr = (void *)addr;
-	page.index = 0;
-	page.inode = inode;
-	for (i = 0; i < count; i++) {
-		/*
-		 * Make sure to not read beyond the requested size
-		 */
-		if (((i + 1) == count) && (size < inode->i_size))
-			last_block_size = size - (i * PAGE_SIZE);
-
-		err = do_readpage(c, inode, &page, last_block_size);
-		if (err)
+	hash_load_start((void *)addr);
+	for (block = 0, done = 0; done < size; block += n) {
+		n = do_bulk_read(c, inode, bu, block, (void *)addr + done,
+				 size - done, tail);
+		if (n <= 0) {
+			ubifs_err("cannot read block %u of inode %lu, error %d",
+				  block, inode->i_ino, n);
+			err = n ? n : -EINVAL;
 			break;
-
-		page.addr += PAGE_SIZE;
-		page.index++;
+		}
+		len = min_t(u32, n << UBIFS_BLOCK_SHIFT, size - done);
+		hash_load_data((void *)addr + done, len);
+		done += len;
 	}
 
 	if (err)
 		printf("Error reading file '%s'\n", filename);
 	else {
+		hash_load_end((void *)addr, size);
 		setenv_hex("filesize", size);
 		printf("Done\n");
 	}
 
+	free(bu->buf);
+out_inode:
+	free(bu);
 	ubifs_iput(inode);
 
 out:
@@ -739,7 +739,12 @@ static inline ino_t parent_ino(struct dentry *dentry)
 #define BOTTOM_UP_HEIGHT 64
 
 /* Maximum number of data nodes to bulk-read */
+#ifndef __UBOOT__
 #define UBIFS_MAX_BULK_READ 32
+#else
+/* As many as it takes to fill a LEB for ubifsload, even if compressed */
+#define UBIFS_MAX_BULK_READ 128
+#endif
 
 /*
  * Lockdep classes for UBIFS inode @ui_mutex.
@@ -91,4 +91,21 @@ void aes_cbc_encrypt_blocks(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks);
  */
 void aes_cbc_decrypt_blocks(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks);
 
+/**
+ * hw_aes_cbc_crypt() - En/decrypt AES-128-CBC blocks with a crypto engine
+ *
+ * aes_cbc_encrypt_blocks() and aes_cbc_decrypt_blocks() try this first when
+ * CONFIG_AES_HW_ACCEL is defined and fall back to software if it fails, so
+ * on error @src must be left as it was, even if it overlaps @dst.
+ *
+ * @key_exp		Expanded key to use (from aes_expand_key())
+ * @src			Source data
+ * @dst			Destination buffer
+ * @num_aes_blocks	Number of AES blocks to process
+ * @enc			1 to encrypt, 0 to decrypt
+ * @return 0 if OK, -ve on error
+ */
+int hw_aes_cbc_crypt(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks,
+		     int enc);
+
 #endif /* _AES_REF_H_ */
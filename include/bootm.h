@@ -9,12 +9,18 @@
 #define _BOOTM_H
 
 #include <command.h>
+#include <errno.h>
 #include <image.h>
 
 #define BOOTM_ERR_RESET		(-1)
 #define BOOTM_ERR_OVERLAP		(-2)
 #define BOOTM_ERR_UNIMPLEMENTED	(-3)
 
+#ifndef CONFIG_SYS_BOOTM_LEN
+/* use 8MByte as default max gunzip size */
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
 /*
  *  Continue booting an OS image; caller already has:
  *  - copied image header to global variable `header'
@@ -73,4 +79,30 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		       void *load_buf, void *image_buf, ulong image_len,
 		       uint unc_len, ulong *load_end);
 
+/*
+ * Inflating a gzipped legacy kernel while it is loaded; the loaders call
+ * these through the CONFIG_HASH_ON_LOAD hooks (see common/gunzip_load.c).
+ * gunzip_load_lookup() returns 0 and sets @size if the image at @image_buf
+ * has already been inflated to @load_buf, -ENOENT if not; a result is only
+ * handed out once.
+ */
+#if defined(CONFIG_GUNZIP_ON_LOAD) && !defined(USE_HOSTCC) && \
+	!defined(CONFIG_SPL_BUILD)
+void gunzip_load_start(void *buf);
+void gunzip_load_data(const void *buf, ulong len);
+void gunzip_load_end(void *buf, ulong len);
+int gunzip_load_lookup(const void *image_buf, ulong image_len,
+		       const void *load_buf, ulong unc_len, ulong *size);
+#else
+static inline void gunzip_load_start(void *buf) {}
+static inline void gunzip_load_data(const void *buf, ulong len) {}
+static inline void gunzip_load_end(void *buf, ulong len) {}
+static inline int gunzip_load_lookup(const void *image_buf, ulong image_len,
+				     const void *load_buf, ulong unc_len,
+				     ulong *size)
+{
+	return -ENOENT;
+}
+#endif
+
 #endif
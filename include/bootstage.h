@@ -195,6 +195,9 @@ enum bootstage_id {
 
 	BOOTSTAGE_ID_ACCUM_LCD,
 	BOOTSTAGE_ID_ACCUM_SCSI,
+	BOOTSTAGE_ID_ACCUM_DECOMP,
+	BOOTSTAGE_ID_ACCUM_HASH_LOAD,
+	BOOTSTAGE_ID_ACCUM_FIT_HASH,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
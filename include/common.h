@@ -730,6 +730,21 @@ int gunzip(void *, int, unsigned char *, unsigned long *);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
 
+/*
+ * Streaming gunzip: start a stream writing at most dstlen bytes to dst,
+ * feed it the compressed data in chunks of any size as they become
+ * available, then finish it to get the uncompressed length.
+ * gunzip_stream_feed() returns 0 if it wants more data, 1 once the end of
+ * the compressed data has been seen and -1 on error. gunzip_stream_finish()
+ * frees the stream and returns 0 if all the data was uncompressed; with a
+ * NULL lenp it just drops the stream, without complaint.
+ */
+struct gunzip_stream;
+struct gunzip_stream *gunzip_stream_start(void *dst, unsigned long dstlen);
+int gunzip_stream_feed(struct gunzip_stream *gs, unsigned char *src,
+		       unsigned long len);
+int gunzip_stream_finish(struct gunzip_stream *gs, unsigned long *lenp);
+
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
 	   int(*compar)(const void *, const void *));
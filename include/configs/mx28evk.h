@@ -33,6 +33,7 @@
 #define CONFIG_CMD_PING
 #define CONFIG_CMD_SAVEENV
 #define CONFIG_CMD_SETEXPR
+#define CONFIG_CMD_TIME
 #if 0
 //#define CONFIG_CMD_SF
 //#define CONFIG_CMD_SPI
@@ -41,6 +42,7 @@
 #define CONFIG_CMD_BOOTZ
 #define CONFIG_CMD_NAND
 #define CONFIG_CMD_NAND_TRIMFFS
+#define CONFIG_CMD_MALLOC
 
 
 /* Memory configuration */
@@ -48,9 +50,12 @@
 #define PHYS_SDRAM_1			0x40000000	/* Base address */
 #define PHYS_SDRAM_1_SIZE		0x08000000	/* 128M RAM */
 #define CONFIG_SYS_SDRAM_BASE		PHYS_SDRAM_1
+#define CONFIG_SYS_MALLOC_SLAB
 
 /* Environment */
 #define CONFIG_ENV_SIZE			(16 * 1024)
+#define CONFIG_ENV_EXPORT_CACHE
+#define CONFIG_ENV_LAZY_IMPORT
 
 /* Environment is in MMC */
 #if defined(CONFIG_CMD_MMC) && defined(CONFIG_ENV_IS_IN_MMC)
@@ -67,19 +72,34 @@
 #define CONFIG_ENV_OFFSET		0x300000
 #define CONFIG_ENV_OFFSET_REDUND	\
 		(CONFIG_ENV_OFFSET + CONFIG_ENV_RANGE)
+#define CONFIG_ENV_SKIP_UNCHANGED
 #endif
 
+/* Environment is a log in NAND, over the same blocks as above */
+#if defined(CONFIG_CMD_NAND) && defined(CONFIG_ENV_IS_IN_NAND_LOG)
+#define CONFIG_ENV_RANGE		(1024 * 1024)
+#define CONFIG_ENV_OFFSET		0x300000
+#endif
 
 
+
+/* FAT on the SD card, read several times by the boot scripts */
+#ifdef CONFIG_CMD_FAT
+#define CONFIG_FS_FAT_MOUNT_CACHE
+#endif
+
 /* UBI and NAND partitioning */
 #ifdef CONFIG_CMD_NAND
 #define CONFIG_CMD_UBI
 #define CONFIG_CMD_UBIFS
+#define CONFIG_MTD_UBI_DEFER_WORK
 #define CONFIG_CMD_MTDPARTS
 #define CONFIG_RBTREE
 #define CONFIG_LZO
 #define CONFIG_MTD_DEVICE
 #define CONFIG_MTD_PARTITIONS
+#define CONFIG_SYS_NAND_ONFI_DETECTION
+#define CONFIG_NAND_MXS_CACHE_READ
 #define MTDIDS_DEFAULT			"nand0=gpmi-nand"
 #define MTDPARTS_DEFAULT			\
 	"mtdparts=gpmi-nand:"			\
@@ -97,6 +117,8 @@
 #define CONFIG_FEC_MXC
 #define CONFIG_NET_MULTI
 #define CONFIG_MX28_FEC_MAC_IN_OCOTP
+#define CONFIG_CMD_TFTPSTORE
+#define CONFIG_TFTP_TSIZE
 #endif
 
 /* RTC */
@@ -114,6 +136,27 @@
 #define	CONFIG_USB_ETHER_SMSC95XX
 #endif
 
+/* DCP crypto/hash engine */
+#define CONFIG_MXS_DCP
+#define CONFIG_SHA_HW_ACCEL
+#define CONFIG_SHA_PROG_HW_ACCEL
+#define CONFIG_AES_HW_ACCEL
+#define CONFIG_SHA1
+#define CONFIG_SHA256
+#define CONFIG_AES
+#define CONFIG_CMD_AES
+#define CONFIG_CMD_HASH
+#define CONFIG_FIT
+#define CONFIG_HASH_ON_LOAD
+#define CONFIG_GUNZIP_ON_LOAD
+
+/* Software SHA-256, for the DCP fallback and SPL */
+#define CONFIG_SHA256_ARMV5
+#define CONFIG_CMD_UT_SHA256
+
+/* CRC32 */
+#define CONFIG_CRC32_SLICE_BY_8
+#define CONFIG_CMD_CRC32_BENCH
 
 /* Boot Linux */
 #define CONFIG_BOOTDELAY	15
@@ -18,6 +18,7 @@
 
 #define CONFIG_IO_TRACE
 #define CONFIG_CMD_IOTRACE
+#define CONFIG_TRACE_HEAP
 
 #define CONFIG_SYS_TIMER_RATE		1000000
 
@@ -62,6 +63,8 @@
  */
 #define CONFIG_MALLOC_F_ADDR		0x0010000
 #define CONFIG_SYS_MALLOC_LEN		(32 << 20)	/* 32MB  */
+#define CONFIG_SYS_MALLOC_SLAB
+#define CONFIG_SYS_MALLOC_SLAB_SIZE	(1 << 20)
 
 #define CONFIG_SYS_HUSH_PARSER
 #define CONFIG_SYS_LONGHELP			/* #undef to save memory */
@@ -79,6 +82,8 @@
 
 #define CONFIG_ENV_SIZE		8192
 #define CONFIG_ENV_IS_NOWHERE
+#define CONFIG_ENV_LAZY_IMPORT
+#define CONFIG_CMD_UT_ENV
 
 /* SPI - enable all SPI flash types for testing purposes */
 #define CONFIG_SANDBOX_SPI
@@ -132,8 +137,23 @@
 
 #define CONFIG_CMD_HASH
 #define CONFIG_HASH_VERIFY
+#define CONFIG_HASH_ON_LOAD
+#define CONFIG_GUNZIP_ON_LOAD
 #define CONFIG_SHA1
 #define CONFIG_SHA256
+#define CONFIG_CMD_UT_SHA256
+#define CONFIG_CMD_MALLOC
+#define CONFIG_CMD_UT_MALLOC
+#define CONFIG_CMD_UT_LMB
+#define CONFIG_LIB_RAND
+#define CONFIG_AES
+
+/* DCP driver, running against a software model of the block */
+#define CONFIG_MXS_DCP
+#define CONFIG_MXS_DCP_SANDBOX
+#define CONFIG_SHA_HW_ACCEL
+#define CONFIG_SHA_PROG_HW_ACCEL
+#define CONFIG_AES_HW_ACCEL
 
 #define CONFIG_TPM_TIS_SANDBOX
 
@@ -86,6 +86,21 @@ extern unsigned long nand_env_oob_offset;
 # endif
 #endif /* CONFIG_ENV_IS_IN_NAND */
 
+#if defined(CONFIG_ENV_IS_IN_NAND_LOG)
+# ifndef CONFIG_ENV_OFFSET
+#  error "Need to define CONFIG_ENV_OFFSET when using CONFIG_ENV_IS_IN_NAND_LOG"
+# endif
+# ifndef CONFIG_ENV_RANGE
+#  error "Need to define CONFIG_ENV_RANGE when using CONFIG_ENV_IS_IN_NAND_LOG"
+# endif
+# ifndef CONFIG_ENV_SIZE
+#  error "Need to define CONFIG_ENV_SIZE when using CONFIG_ENV_IS_IN_NAND_LOG"
+# endif
+# ifdef CONFIG_ENV_AES
+#  error "CONFIG_ENV_AES is not supported with CONFIG_ENV_IS_IN_NAND_LOG"
+# endif
+#endif /* CONFIG_ENV_IS_IN_NAND_LOG */
+
 #if defined(CONFIG_ENV_IS_IN_UBI)
 # ifndef CONFIG_ENV_UBI_PART
 #  error "Need to define CONFIG_ENV_UBI_PART when using CONFIG_ENV_IS_IN_UBI"
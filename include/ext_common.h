@@ -154,11 +154,20 @@ struct ext2_dirent {
 	uint8_t filetype;
 };
 
+/* A run of blocks of a file that uses extents, see read_allocated_run() */
+struct ext4_extent_cache {
+	uint32_t block;		/* first logical block */
+	uint32_t len;		/* in blocks, 0 if nothing is cached */
+	uint64_t start;		/* first physical block, 0 for a hole */
+	int uninit;		/* allocated but unwritten, reads as zeros */
+};
+
 struct ext2fs_node {
 	struct ext2_data *data;
 	struct ext2_inode inode;
 	int ino;
 	int inode_read;
+	struct ext4_extent_cache extent;	/* the last one looked up */
 };
 
 /* Information about a "mounted" ext2 filesystem. */
@@ -27,6 +27,30 @@
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
+/*
+ * Reading goes through a cache of CONFIG_FS_FAT_CACHE_WINDOWS windows of
+ * CONFIG_FS_FAT_CACHE_BLOCKS sectors of the FAT each, see get_fatent();
+ * writing through a single buffer of FATBUFBLOCKS sectors.
+ */
+#ifndef CONFIG_FS_FAT_CACHE_BLOCKS
+#define CONFIG_FS_FAT_CACHE_BLOCKS	32
+#endif
+#ifndef CONFIG_FS_FAT_CACHE_WINDOWS
+#define CONFIG_FS_FAT_CACHE_WINDOWS	8
+#endif
+
+/*
+ * With CONFIG_FS_FAT_MOUNT_CACHE the volume stays mounted between reads,
+ * with its FAT cache and the directory entries of the last
+ * CONFIG_FS_FAT_DENT_CACHE paths looked up, until the device changes or
+ * the volume is written to. Longer paths than DENT_CACHE_NAMELEN are
+ * looked up every time.
+ */
+#ifndef CONFIG_FS_FAT_DENT_CACHE
+#define CONFIG_FS_FAT_DENT_CACHE	16
+#endif
+#define DENT_CACHE_NAMELEN	128
+
 #define FATBUFBLOCKS	6
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
@@ -173,7 +197,15 @@ typedef struct {
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
-	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+	int	fatbufnum;	/* Used by get_fatent_value, init to -1 */
+	__u8	*fatcache;	/* FAT windows read by get_fatent */
+	int	fatcache_wins;	/* Number of windows in fatcache */
+	int	fatcache_last;	/* Window used last */
+	__u32	fatcache_clock;
+	struct {
+		__u32	num;	/* Window of the FAT held, -1 if none */
+		__u32	used;	/* fatcache_clock when last used */
+	} fatwin[CONFIG_FS_FAT_CACHE_WINDOWS];
 } fsdata;
 
 typedef int	(file_detectfs_func)(void);
@@ -211,4 +243,10 @@ int file_fat_write(const char *filename, void *buf, loff_t offset, loff_t len,
 int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		  loff_t *actread);
 void fat_close(void);
+/* Also called by block drivers, which SPL may have without FAT */
+#if defined(CONFIG_FS_FAT_MOUNT_CACHE) && !defined(CONFIG_SPL_BUILD)
+void fat_invalidate(void);
+#else
+static inline void fat_invalidate(void) {}
+#endif
 #endif /* _FAT_H_ */
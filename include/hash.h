@@ -6,6 +6,8 @@
 #ifndef _HASH_H
 #define _HASH_H
 
+#include <errno.h>
+
 /*
  * Maximum digest size for all algorithms we support. Having this value
  * avoids a malloc() or C99 local declaration in common/cmd_hash.c.
@@ -129,6 +131,86 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 void hash_show(struct hash_algo *algo, ulong addr, ulong len,
 	       uint8_t *output);
 
+#if defined(CONFIG_HASH_ON_LOAD) && !defined(CONFIG_SPL_BUILD)
+/**
+ * hash_load_start() - Start hashing a file as it is loaded
+ *
+ * Called by a load command before it reads a file to @buf. If the file turns
+ * out to be a FIT, the large properties of its images are hashed as the data
+ * arrives and fit_image_check_hash() can use the result. Anything remembered
+ * from an earlier load is forgotten.
+ *
+ * @buf:	Where the file will be loaded, or NULL just to forget
+ */
+void hash_load_start(void *buf);
+
+/**
+ * hash_load_command() - Tell the load hash that a command is about to run
+ *
+ * Forgets the digests of the last load unless the command is known not to
+ * write to memory.
+ *
+ * @name:	Name of the command
+ */
+void hash_load_command(const char *name);
+
+/**
+ * hash_load_drop() - Forget the digests of the last load
+ *
+ * Unlike hash_load_start(NULL), this leaves CONFIG_GUNZIP_ON_LOAD alone. bootm
+ * calls it once the images are checked, before it writes to memory.
+ */
+void hash_load_drop(void);
+
+/**
+ * hash_load_data() - Tell the load hash that data has arrived in memory
+ *
+ * Drivers call this once each piece of the file is in place. Pieces that do
+ * not continue the file where the last one ended are ignored, so it is safe
+ * to call for reads that have nothing to do with the file being loaded.
+ *
+ * @buf:	Data that was just written
+ * @len:	Its length in bytes
+ */
+void hash_load_data(const void *buf, ulong len);
+
+/**
+ * hash_load_end() - Finish hashing a file that was loaded successfully
+ *
+ * Hashes whatever the drivers did not pass to hash_load_data(), from memory.
+ * Until this is called, no digest of the load is used.
+ *
+ * @buf:	Where the file was loaded, as given to hash_load_start()
+ * @len:	Length of the file
+ */
+void hash_load_end(void *buf, ulong len);
+
+/**
+ * hash_load_lookup() - Get a digest computed while the data was loaded
+ *
+ * @data:	Start of the data
+ * @len:	Length of the data
+ * @algo_name:	Hash algorithm wanted
+ * @value:	Returns the digest, laid out as calculate_hash() does it
+ * @value_len:	Returns the length of the digest
+ * @return 0 if ok, -ENOENT if the data was not hashed while it was loaded
+ */
+int hash_load_lookup(const void *data, ulong len, const char *algo_name,
+		     uint8_t *value, int *value_len);
+#else
+static inline void hash_load_start(void *buf) {}
+static inline void hash_load_command(const char *name) {}
+static inline void hash_load_drop(void) {}
+static inline void hash_load_data(const void *buf, ulong len) {}
+static inline void hash_load_end(void *buf, ulong len) {}
+static inline int hash_load_lookup(const void *data, ulong len,
+				   const char *algo_name, uint8_t *value,
+				   int *value_len)
+{
+	return -ENOENT;
+}
+#endif
+
 #endif /* !USE_HOSTCC */
 
 /**
@@ -872,6 +872,11 @@ extern Void_t*     sbrk();
 
 #else
 
+#if (defined(CONFIG_SYS_MALLOC_SLAB) || defined(CONFIG_TRACE_HEAP)) && \
+	!defined(CONFIG_SPL_BUILD)
+#define MALLOC_FRONT_END
+#endif
+
 #ifdef CONFIG_SYS_MALLOC_SIMPLE
 #define malloc malloc_simple
 #define realloc realloc_simple
@@ -892,6 +897,17 @@ void *realloc_simple(void *ptr, size_t size);
 # define pvALLOc		dlpvalloc
 # define mALLINFo	dlmallinfo
 # define mALLOPt		dlmallopt
+# elif defined(MALLOC_FRONT_END)
+/* The front ends below own these and pass on what they do not handle */
+# define cALLOc		dlcalloc
+# define fREe		dlfree
+# define mALLOc		dlmalloc
+# define mEMALIGn	dlmemalign
+# define rEALLOc		dlrealloc
+# define vALLOc		valloc
+# define pvALLOc		pvalloc
+# define mALLINFo	mallinfo
+# define mALLOPt		mallopt
 # else /* USE_DL_PREFIX */
 # define cALLOc		calloc
 # define fREe		free
@@ -941,6 +957,42 @@ void    malloc_stats();
 int     mALLOPt();
 struct mallinfo mALLINFo();
 # endif
+
+# ifdef MALLOC_FRONT_END
+/*
+ * dlmalloc is at the bottom, with the dl prefix. The slab front end in
+ * malloc_slab.c sits on it with the sl prefix, and the tracer in
+ * malloc_trace.c on top with the public names. Either may be left out.
+ */
+#  ifndef CONFIG_TRACE_HEAP
+#   define slmalloc	malloc
+#   define slfree	free
+#   define slrealloc	realloc
+#   define slmemalign	memalign
+#   define slcalloc	calloc
+#  elif !defined(CONFIG_SYS_MALLOC_SLAB)
+#   define slmalloc	dlmalloc
+#   define slfree	dlfree
+#   define slrealloc	dlrealloc
+#   define slmemalign	dlmemalign
+#   define slcalloc	dlcalloc
+#  endif
+
+void *malloc(size_t bytes);
+void free(void *mem);
+void *realloc(void *mem, size_t bytes);
+void *memalign(size_t alignment, size_t bytes);
+void *calloc(size_t n, size_t elem_size);
+
+void *slmalloc(size_t bytes);
+void slfree(void *mem);
+void *slrealloc(void *mem, size_t bytes);
+void *slmemalign(size_t alignment, size_t bytes);
+void *slcalloc(size_t n, size_t elem_size);
+
+/* Print the use of each size class */
+void malloc_slab_stats(void);
+# endif
 #endif
 
 /*
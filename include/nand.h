@@ -130,6 +130,10 @@ void nand_deselect(void);
 void board_nand_select_device(struct nand_chip *nand, int chip);
 #endif
 
+#ifdef CONFIG_NAND_MXS
+void mxs_nand_print_stats(nand_info_t *nand);
+#endif
+
 __attribute__((noreturn)) void nand_boot(void);
 
 #endif
@@ -728,6 +728,39 @@ extern unsigned int random_port(void);
 /* Update U-Boot over TFTP */
 extern int update_tftp(ulong addr);
 
+#ifdef CONFIG_CMD_TFTPSTORE
+/**
+ * struct tftp_sink - where a TFTP get stores the file instead of memory
+ *
+ * TFTP gathers the received blocks and hands them to @write in chunks of
+ * @size bytes, right after acknowledging the block which completed the
+ * chunk. The last chunk may be shorter. @buf has room to pad it up to
+ * @size. If the transfer restarts, @start is called again and the file
+ * is written from offset 0 once more.
+ *
+ * @name:	Shown in messages, e.g. "UBI volume rootfs"
+ * @size:	Number of bytes to gather before calling @write
+ * @start:	Optional, called when the first block arrives. @total is the
+ *		file size reported by the server (tsize option) or 0
+ * @write:	Store @len bytes from @buf at @offset bytes into the target
+ * @finish:	Optional, called after the last chunk with the file size
+ * @priv:	Private data of the sink
+ * All callbacks return 0 on success, else an error code.
+ */
+struct tftp_sink {
+	const char *name;
+	ulong size;
+	int (*start)(struct tftp_sink *sink, ulong total);
+	int (*write)(struct tftp_sink *sink, ulong offset, uchar *buf,
+		     ulong len);
+	int (*finish)(struct tftp_sink *sink, ulong total);
+	void *priv;
+};
+
+/* Make the next TFTP get store to @sink, or to memory if NULL */
+void tftp_set_sink(struct tftp_sink *sink);
+#endif
+
 /**********************************************************************/
 
 #endif /* __NET_H__ */
@@ -210,6 +210,8 @@ int mv88e61xx_switch_initialize(struct mv88e61xx_config *swconfig);
 #endif /* CONFIG_MV88E61XX_SWITCH */
 
 struct mii_dev *fec_get_miibus(uint32_t base_addr, int dev_id);
+/* Wait until the frames queued by the FEC driver have been sent */
+int fecmxc_flush(struct eth_device *dev);
 #ifdef CONFIG_PHYLIB
 struct phy_device;
 int fec_probe(bd_t *bd, int dev_id, uint32_t base_addr,
@@ -39,8 +39,10 @@ typedef struct entry {
 	int flags;
 } ENTRY;
 
-/* Opaque type for internal use.  */
+/* Opaque types for internal use.  */
 struct _ENTRY;
+struct hexport_cache;
+struct hlazy;
 
 /*
  * Family of hash table handling functions.  The functions also
@@ -53,6 +55,12 @@ struct hsearch_data {
 	struct _ENTRY *table;
 	unsigned int size;
 	unsigned int filled;
+	/* Entries created, changed or deleted since the last cached export */
+	unsigned int changed;
+	/* Output of the last full export, see hexport_r() */
+	struct hexport_cache *cache;
+	/* Variables imported but not entered yet, see himport_r() */
+	struct hlazy *lazy;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -120,5 +128,6 @@ extern int hwalk_r(struct hsearch_data *__htab, int (*callback)(ENTRY *));
 #define H_MATCH_SUBSTR	(1 << 7) /* search for substring matches	     */
 #define H_MATCH_REGEX	(1 << 8) /* search for regular expression matches    */
 #define H_MATCH_METHOD	(H_MATCH_IDENT | H_MATCH_SUBSTR | H_MATCH_REGEX)
+#define H_LAZY		(1 << 9) /* enter imported variables on first use */
 
 #endif /* search.h */
@@ -29,6 +29,7 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_HEAP,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -80,6 +81,40 @@ struct trace_call {
 
 int trace_list_calls(void *buff, int buff_size, unsigned int *needed);
 
+/* Flags for trace_heap */
+enum heap_trace_flags {
+	HEAPF_FREE		= 0UL << 30,
+	HEAPF_MALLOC		= 1UL << 30,
+	HEAPF_MEMALIGN		= 2UL << 30,
+
+	HEAPF_TIMESTAMP_MASK	= 0x3fffffff,
+};
+
+#define TRACE_HEAP_TYPE(rec)	((rec)->flags & 0xc0000000UL)
+
+/* A call to malloc(), free() and the like */
+struct trace_heap {
+	uint32_t caller;	/* Offset of the return address into the code */
+	uint32_t ptr;		/* Offset of the block into the heap */
+	uint32_t size;		/* Size asked for, 0 for free() */
+	uint32_t flags;		/* Flags and timestamp */
+};
+
+/**
+ * Dump the heap trace into a buffer, oldest record first
+ *
+ * This works like trace_list_calls(), with a TRACE_CHUNK_HEAP header.
+ *
+ * @param buff		Buffer in which to place data, or NULL to count size
+ * @param buff_size	Size of buffer
+ * @param needed	Returns number of bytes used / needed
+ * @return 0 if ok, -1 on error (buffer exhausted)
+ */
+int trace_list_heap(void *buff, int buff_size, unsigned int *needed);
+
+/* Print how many heap calls were recorded and how many were overwritten */
+void trace_heap_stats(void);
+
 /**
  * Turn function tracing on and off
  *
@@ -14,6 +14,24 @@ uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 
+/**
+ * struct crc32_variant - An implementation of crc32_no_comp()
+ *
+ * The crc32bench command times each of these; crc32_variants[] ends with
+ * an entry whose name is NULL.
+ *
+ * @name:	Name of the variant
+ * @table_size:	Bytes of lookup tables it uses
+ * @crc:	Same as crc32_no_comp()
+ */
+struct crc32_variant {
+	const char *name;
+	uint table_size;
+	uint32_t (*crc)(uint32_t, const unsigned char *, uint);
+};
+
+extern const struct crc32_variant crc32_variants[];
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -19,4 +19,33 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * sha256_block_armv5() - Hash whole blocks with the ARMv5 assembler code
+ *
+ * Selected by CONFIG_SHA256_ARMV5, see arch/arm/lib/sha256_armv5.S.
+ *
+ * @state:	Hash state, updated in place
+ * @data:	Input, any alignment
+ * @blocks:	Number of 64-byte blocks, at least one
+ */
+void sha256_block_armv5(uint32_t state[8], const uint8_t *data,
+			unsigned int blocks);
+
+/**
+ * struct sha256_variant - A block function that sha256_update() can use
+ *
+ * The ut_sha256 command checks each of these against the generic one and
+ * times it; sha256_variants[] ends with an entry whose name is NULL.
+ *
+ * @name:	Name of the variant
+ * @blocks:	Hash whole 64-byte blocks into the state
+ */
+struct sha256_variant {
+	const char *name;
+	void (*blocks)(uint32_t state[8], const uint8_t *data,
+		       unsigned int blocks);
+};
+
+extern const struct sha256_variant sha256_variants[];
+
 #endif /* _SHA256_H */
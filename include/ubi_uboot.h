@@ -63,6 +63,11 @@
 #define CONFIG_MTD_UBI_BEB_LIMIT	20
 #endif
 
+#if defined(CONFIG_MTD_UBI_DEFER_WORK) && \
+	!defined(CONFIG_MTD_UBI_MAX_DEFERRED_WORKS)
+#define CONFIG_MTD_UBI_MAX_DEFERRED_WORKS	16
+#endif
+
 /* build.c */
 #define get_device(...)
 #define put_device(...)
@@ -79,7 +84,13 @@ extern int ubi_init(void);
 extern void ubi_exit(void);
 extern int ubi_part(char *part_name, const char *vid_header_offset);
 extern int ubi_volume_write(char *volume, void *buf, size_t size);
+extern int ubi_volume_begin_write(char *volume, void *buf, size_t size,
+				  size_t full_size);
+extern int ubi_volume_continue_write(char *volume, void *buf, size_t size);
 extern int ubi_volume_read(char *volume, char *buf, size_t size);
+#ifdef CONFIG_MTD_UBI_DEFER_WORK
+extern void ubi_flush_deferred_works(void);
+#endif
 
 extern struct ubi_device *ubi_devices[];
 
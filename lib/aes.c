@@ -609,6 +609,11 @@ void aes_cbc_encrypt_blocks(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks)
 	u8 *cbc_chain_data = zero_key;
 	u32 i;
 
+#if defined(CONFIG_AES_HW_ACCEL) && !defined(USE_HOSTCC)
+	if (!hw_aes_cbc_crypt(key_exp, src, dst, num_aes_blocks, 1))
+		return;
+#endif
+
 	for (i = 0; i < num_aes_blocks; i++) {
 		debug("encrypt_object: block %d of %d\n", i, num_aes_blocks);
 		debug_print_vector("AES Src", AES_KEY_LENGTH, src);
@@ -635,6 +640,11 @@ void aes_cbc_decrypt_blocks(u8 *key_exp, u8 *src, u8 *dst, u32 num_aes_blocks)
 	u8 cbc_chain_data[AES_KEY_LENGTH] = { 0 };
 	u32 i;
 
+#if defined(CONFIG_AES_HW_ACCEL) && !defined(USE_HOSTCC)
+	if (!hw_aes_cbc_crypt(key_exp, src, dst, num_aes_blocks, 0))
+		return;
+#endif
+
 	for (i = 0; i < num_aes_blocks; i++) {
 		debug("encrypt_object: block %d of %d\n", i, num_aes_blocks);
 		debug_print_vector("AES Src", AES_KEY_LENGTH, src);
@@ -26,6 +26,21 @@
 
 #define tole(x) cpu_to_le32(x)
 
+/*
+ * CONFIG_CRC32_SLICE_BY_4 and CONFIG_CRC32_SLICE_BY_8 process 4 or 8 bytes
+ * with independent table lookups, at the cost of 3 or 7 KiB of extra tables.
+ * The crc32bench command compares all variants, so it needs every table.
+ */
+#if !defined(USE_HOSTCC) && !defined(DYNAMIC_CRC_TABLE) && \
+	__BYTE_ORDER == __LITTLE_ENDIAN
+# if defined(CONFIG_CRC32_SLICE_BY_8) || \
+	(defined(CONFIG_CMD_CRC32_BENCH) && !defined(CONFIG_SPL_BUILD))
+#  define CRC32_SLICE_TABLES	8
+# elif defined(CONFIG_CRC32_SLICE_BY_4)
+#  define CRC32_SLICE_TABLES	4
+# endif
+#endif
+
 #ifdef DYNAMIC_CRC_TABLE
 
 local int crc_table_empty = 1;
@@ -151,6 +166,10 @@ tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
 
+#ifdef CRC32_SLICE_TABLES
+#include "crc32_slice.h"
+#endif
+
 #if 0
 /* =========================================================================
  * This function can be used by asm versions of crc32()
@@ -173,10 +192,13 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
+/*
+ * One table lookup per byte, fetching the data a word at a time. Unused when
+ * a slicing variant is built in without crc32bench; tools/ has no
+ * __maybe_unused, hence the plain attribute.
  */
-uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+local uint32_t __attribute__((unused)) crc32_word(uint32_t crc,
+						 const Bytef *buf, uInt len)
 {
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
@@ -216,8 +238,112 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 
     return le32_to_cpu(crc);
 }
+
+#ifdef CRC32_SLICE_TABLES
+/*
+ * Slicing-by-N: fold N bytes into the CRC with N lookups that do not depend
+ * on each other, in crc_table and crc_table_slice. Little-endian only, so the
+ * CRC needs no byte swapping.
+ */
+local const uint8_t *crc32_align(uint32_t *crcp, const uint8_t *p, uInt *lenp)
+{
+    const uint32_t *tab = crc_table;
+    uint32_t crc = *crcp;
+
+    while (*lenp && ((long)p & 3)) {
+	 DO_CRC(*p++);
+	 (*lenp)--;
+    }
+    *crcp = crc;
+
+    return p;
+}
+
+local uint32_t crc32_tail(uint32_t crc, const uint8_t *p, uInt len)
+{
+    const uint32_t *tab = crc_table;
+
+    while (len--)
+	 DO_CRC(*p++);
+
+    return crc;
+}
+
+local uint32_t __maybe_unused crc32_slice4(uint32_t crc, const Bytef *buf,
+					    uInt len)
+{
+    const uint32_t *t0 = crc_table;
+    const uint32_t *t1 = crc_table_slice[0];
+    const uint32_t *t2 = crc_table_slice[1];
+    const uint32_t *t3 = crc_table_slice[2];
+    const uint32_t *b;
+
+    b = (const uint32_t *)crc32_align(&crc, buf, &len);
+    for (; len >= 4; len -= 4) {
+	 crc ^= *b++;
+	 crc = t3[crc & 255] ^ t2[(crc >> 8) & 255] ^
+	       t1[(crc >> 16) & 255] ^ t0[crc >> 24];
+    }
+
+    return crc32_tail(crc, (const uint8_t *)b, len);
+}
+
+#if CRC32_SLICE_TABLES > 4
+local uint32_t __maybe_unused crc32_slice8(uint32_t crc, const Bytef *buf,
+					    uInt len)
+{
+    const uint32_t *t0 = crc_table;
+    const uint32_t *t1 = crc_table_slice[0];
+    const uint32_t *t2 = crc_table_slice[1];
+    const uint32_t *t3 = crc_table_slice[2];
+    const uint32_t *t4 = crc_table_slice[3];
+    const uint32_t *t5 = crc_table_slice[4];
+    const uint32_t *t6 = crc_table_slice[5];
+    const uint32_t *t7 = crc_table_slice[6];
+    const uint32_t *b;
+    uint32_t next;
+
+    b = (const uint32_t *)crc32_align(&crc, buf, &len);
+    for (; len >= 8; len -= 8) {
+	 crc ^= *b++;
+	 next = *b++;
+	 crc = t7[crc & 255] ^ t6[(crc >> 8) & 255] ^
+	       t5[(crc >> 16) & 255] ^ t4[crc >> 24] ^
+	       t3[next & 255] ^ t2[(next >> 8) & 255] ^
+	       t1[(next >> 16) & 255] ^ t0[next >> 24];
+    }
+
+    return crc32_tail(crc, (const uint8_t *)b, len);
+}
+#endif
+#endif /* CRC32_SLICE_TABLES */
 #undef DO_CRC
 
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+#if defined(CONFIG_CRC32_SLICE_BY_8) && defined(CRC32_SLICE_TABLES)
+    return crc32_slice8(crc, buf, len);
+#elif defined(CONFIG_CRC32_SLICE_BY_4) && defined(CRC32_SLICE_TABLES)
+    return crc32_slice4(crc, buf, len);
+#else
+    return crc32_word(crc, buf, len);
+#endif
+}
+
+#if defined(CONFIG_CMD_CRC32_BENCH) && !defined(CONFIG_SPL_BUILD)
+const struct crc32_variant crc32_variants[] = {
+    { "word", sizeof(crc_table), crc32_word },
+#ifdef CRC32_SLICE_TABLES
+    { "slice-by-4", 4 * sizeof(crc_table), crc32_slice4 },
+    { "slice-by-8", 8 * sizeof(crc_table), crc32_slice8 },
+#endif
+    { NULL }
+};
+#endif
+
 uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
 {
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
@@ -37,28 +37,52 @@ void gzfree(void *x, void *addr, unsigned nb)
 	free (addr);
 }
 
-int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+/*
+ * Return the length of the gzip header at @src, 0 if the @len bytes
+ * available do not hold all of it yet, or -1 if it is not gzip data.
+ */
+static int gzip_header_len(const unsigned char *src, unsigned long len)
 {
-	int i, flags;
+	unsigned long i = 10;
+	int flags;
 
-	/* skip header */
-	i = 10;
+	if (len < i)
+		return 0;
 	flags = src[3];
-	if (src[2] != DEFLATED || (flags & RESERVED) != 0) {
-		puts ("Error: Bad gzipped data\n");
-		return (-1);
-	}
-	if ((flags & EXTRA_FIELD) != 0)
+	if (src[2] != DEFLATED || (flags & RESERVED) != 0)
+		return -1;
+	if ((flags & EXTRA_FIELD) != 0) {
+		if (len < 12)
+			return 0;
 		i = 12 + src[10] + (src[11] << 8);
-	if ((flags & ORIG_NAME) != 0)
-		while (src[i++] != 0)
-			;
-	if ((flags & COMMENT) != 0)
-		while (src[i++] != 0)
-			;
+	}
+	if ((flags & ORIG_NAME) != 0) {
+		while (i < len && src[i] != 0)
+			i++;
+		i++;
+	}
+	if ((flags & COMMENT) != 0) {
+		while (i < len && src[i] != 0)
+			i++;
+		i++;
+	}
 	if ((flags & HEAD_CRC) != 0)
 		i += 2;
-	if (i >= *lenp) {
+
+	/* The deflate data must follow the header */
+	return i < len ? i : 0;
+}
+
+int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+{
+	int i;
+
+	i = gzip_header_len(src, *lenp);
+	if (i < 0) {
+		puts ("Error: Bad gzipped data\n");
+		return (-1);
+	}
+	if (i == 0) {
 		puts ("Error: gunzip out of data in header\n");
 		return (-1);
 	}
@@ -66,6 +90,121 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, i);
 }
 
+/*
+ * Streaming gunzip. The gzip header is gathered in @hdr until it is
+ * complete, everything after it goes straight to inflate(), which writes
+ * to the destination buffer as it goes.
+ */
+#define GZIP_STREAM_HDR_MAX	512
+
+struct gunzip_stream {
+	z_stream s;
+	unsigned char hdr[GZIP_STREAM_HDR_MAX];
+	unsigned long hdr_len;	/* bytes gathered in hdr */
+	int started;		/* header parsed */
+	int done;		/* end of the deflate stream seen */
+};
+
+struct gunzip_stream *gunzip_stream_start(void *dst, unsigned long dstlen)
+{
+	struct gunzip_stream *gs;
+	int r;
+
+	gs = malloc(sizeof(*gs));
+	if (!gs)
+		return NULL;
+	memset(gs, 0, sizeof(*gs));
+
+	gs->s.zalloc = gzalloc;
+	gs->s.zfree = gzfree;
+	r = inflateInit2(&gs->s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		free(gs);
+		return NULL;
+	}
+	gs->s.next_out = dst;
+	gs->s.avail_out = dstlen;
+
+	return gs;
+}
+
+static int gunzip_stream_inflate(struct gunzip_stream *gs,
+				 unsigned char *src, unsigned long len)
+{
+	int r;
+
+	gs->s.next_in = src;
+	gs->s.avail_in = len;
+	while (gs->s.avail_in) {
+		r = inflate(&gs->s, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			gs->done = 1;
+			return 1;
+		}
+		if (r != Z_OK) {
+			if (!gs->s.avail_out)
+				puts("Error: gunzip output buffer too small\n");
+			else
+				printf("Error: inflate() returned %d\n", r);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int gunzip_stream_feed(struct gunzip_stream *gs, unsigned char *src,
+		       unsigned long len)
+{
+	unsigned long n;
+	int i, r;
+
+	/* Whatever follows the deflate data (the gzip trailer) is ignored */
+	if (gs->done)
+		return 1;
+
+	if (!gs->started) {
+		n = min(len, sizeof(gs->hdr) - gs->hdr_len);
+		memcpy(gs->hdr + gs->hdr_len, src, n);
+		gs->hdr_len += n;
+		src += n;
+		len -= n;
+
+		i = gzip_header_len(gs->hdr, gs->hdr_len);
+		if (i < 0 || (!i && gs->hdr_len == sizeof(gs->hdr))) {
+			puts("Error: Bad gzipped data\n");
+			return -1;
+		}
+		if (!i)
+			return 0;
+		gs->started = 1;
+
+		r = gunzip_stream_inflate(gs, gs->hdr + i, gs->hdr_len - i);
+		if (r)
+			return r;
+	}
+
+	return gunzip_stream_inflate(gs, src, len);
+}
+
+int gunzip_stream_finish(struct gunzip_stream *gs, unsigned long *lenp)
+{
+	int ret = 0;
+
+	if (!gs->done) {
+		if (lenp)
+			puts("Error: gzipped data is truncated\n");
+		ret = -1;
+	}
+	if (lenp)
+		*lenp = gs->s.total_out;
+	inflateEnd(&gs->s);
+	free(gs);
+
+	return ret;
+}
+
 /*
  * Uncompress blocks compressed with zlib without headers
  */
@@ -59,6 +59,7 @@
 
 typedef struct _ENTRY {
 	int used;
+	int dirty;	/* changed since the last cached export */
 	ENTRY entry;
 } _ENTRY;
 
@@ -66,6 +67,169 @@ typedef struct _ENTRY {
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/* Remember that an entry differs from what the export cache holds */
+static inline void _hmark_dirty(struct hsearch_data *htab, int idx)
+{
+	htab->table[idx].dirty = 1;
+	++htab->changed;
+}
+
+#ifdef CONFIG_ENV_EXPORT_CACHE
+/*
+ * The export cache keeps the output of the last full '\0'-separated
+ * export, which is what saveenv writes, and where each entry sits in it.
+ * See hexport_update().
+ */
+struct hexport_item {
+	int idx;		/* slot in htab->table */
+	size_t off;		/* of "name=value\0" in buf */
+	size_t len;
+};
+
+struct hexport_cache {
+	char *buf;
+	size_t len;		/* not counting the final '\0' */
+	int n;
+	struct hexport_item item[];
+};
+
+static void hexport_drop_cache(struct hsearch_data *htab)
+{
+	if (htab->cache) {
+		free(htab->cache->buf);
+		free(htab->cache);
+		htab->cache = NULL;
+	}
+}
+#else
+static inline void hexport_drop_cache(struct hsearch_data *htab)
+{
+}
+#endif
+
+/* Compute an value for the given string. Perhaps use a better method. */
+static unsigned int _hhash(const char *key)
+{
+	unsigned int len = strlen(key);
+	unsigned int hval = len;
+
+	while (len-- > 0) {
+		hval <<= 4;
+		hval += key[len];
+	}
+
+	return hval;
+}
+
+#ifdef CONFIG_ENV_LAZY_IMPORT
+/*
+ * Lazy import
+ *
+ * With H_LAZY, himport_r() keeps its parsed copy of the data and only
+ * indexes it by hash. A variable is entered into the table, with its
+ * callback and flags looked up as usual, when hsearch_r() is first asked
+ * about it; anything that looks at the whole table enters all that are
+ * left first. hdelete_r() goes through hsearch_r() too.
+ */
+struct hlazy_ent {
+	unsigned int hval;	/* _hhash() of key */
+	const char *key;	/* NULL once entered */
+	const char *data;
+};
+
+struct hlazy {
+	char *data;		/* parsed copy of the imported environment */
+	int flag;		/* to enter the variables with */
+	int n;
+	int left;		/* not entered yet */
+	int busy;		/* entering one, so keep data */
+	struct hlazy_ent ent[];
+};
+
+static int cmplazy(const void *p1, const void *p2)
+{
+	const struct hlazy_ent *e1 = p1;
+	const struct hlazy_ent *e2 = p2;
+
+	if (e1->hval != e2->hval)
+		return e1->hval < e2->hval ? -1 : 1;
+	/* the last definition of a name wins */
+	return e1->key < e2->key ? -1 : (e1->key > e2->key);
+}
+
+static void hlazy_drop(struct hsearch_data *htab)
+{
+	if (htab->lazy) {
+		free(htab->lazy->data);
+		free(htab->lazy);
+		htab->lazy = NULL;
+	}
+}
+
+/* Enter 'key' into the table if it is still waiting in the index */
+static void hlazy_get(struct hsearch_data *htab, const char *key)
+{
+	struct hlazy *lz = htab->lazy;
+	struct hlazy_ent *ep, *found = NULL;
+	unsigned int hval = _hhash(key);
+	int lo = 0, hi = lz->n;
+	ENTRY e, *rv;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (lz->ent[mid].hval < hval)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (ep = &lz->ent[lo]; ep < &lz->ent[lz->n] && ep->hval == hval;
+	     ++ep) {
+		if (ep->key && !strcmp(ep->key, key)) {
+			found = ep;
+			ep->key = NULL;
+			--lz->left;
+		}
+	}
+	if (found == NULL)
+		return;
+
+	e.key = key;
+	e.data = (char *)found->data;
+	++lz->busy;
+	hsearch_r(e, ENTER, &rv, htab, lz->flag);
+	if (rv == NULL)
+		printf("himport_r: can't insert \"%s=%s\" into hash table\n",
+			e.key, e.data);
+	if (--lz->busy == 0 && lz->left == 0)
+		hlazy_drop(htab);
+}
+
+/*
+ * Enter everything that is left. Entering a variable can get here again,
+ * when its callback walks the table as setting ".callbacks" does; then all
+ * is entered all the same, and the outer hlazy_get() drops the index.
+ */
+static void hlazy_flush(struct hsearch_data *htab)
+{
+	int i;
+
+	for (i = 0; htab->lazy && i < htab->lazy->n; ++i) {
+		if (htab->lazy->ent[i].key)
+			hlazy_get(htab, htab->lazy->ent[i].key);
+	}
+}
+#else
+static inline void hlazy_drop(struct hsearch_data *htab)
+{
+}
+
+static inline void hlazy_flush(struct hsearch_data *htab)
+{
+}
+#endif
+
 /*
  * hcreate()
  */
@@ -116,6 +280,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 	htab->size = nel;
 	htab->filled = 0;
+	htab->changed = 0;
 
 	/* allocate memory and zero out */
 	htab->table = (_ENTRY *) calloc(htab->size + 1, sizeof(_ENTRY));
@@ -156,6 +321,8 @@ void hdestroy_r(struct hsearch_data *htab)
 		}
 	}
 	free(htab->table);
+	hexport_drop_cache(htab);
+	hlazy_drop(htab);
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
@@ -204,6 +371,8 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
+	hlazy_flush(htab);
+
 	for (idx = last_idx + 1; idx < htab->size; ++idx) {
 		if (htab->table[idx].used <= 0)
 			continue;
@@ -259,6 +428,7 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				*retval = NULL;
 				return 0;
 			}
+			_hmark_dirty(htab, idx);
 		}
 		/* return found entry */
 		*retval = &htab->table[idx].entry;
@@ -272,19 +442,16 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	      struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
 	unsigned int idx;
 	unsigned int first_deleted = 0;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
+#ifdef CONFIG_ENV_LAZY_IMPORT
+	if (htab->lazy)
+		hlazy_get(htab, item.key);
+#endif
+
+	hval = _hhash(item.key);
 
 	/*
 	 * First hash function:
@@ -375,6 +542,7 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		}
 
 		++htab->filled;
+		_hmark_dirty(htab, idx);
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -435,6 +603,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	ep->callback = NULL;
 	ep->flags = 0;
 	htab->table[idx].used = -1;
+	_hmark_dirty(htab, idx);
 
 	--htab->filled;
 }
@@ -587,6 +756,173 @@ static int match_entry(ENTRY *ep, int flag,
 	return 0;
 }
 
+/* Write one "name=value" and the separator; returns the end of it */
+static char *hexport_entry(char *p, const ENTRY *ep, char sep)
+{
+	const char *s;
+
+	s = ep->key;
+	while (*s)
+		*p++ = *s++;
+	*p++ = '=';
+
+	s = ep->data;
+
+	while (*s) {
+		if ((*s == sep) || (*s == '\\'))
+			*p++ = '\\';	/* escape */
+		*p++ = *s++;
+	}
+	*p++ = sep;
+
+	return p;
+}
+
+/* Check or allocate the result buffer, see above, and clear it */
+static char *hexport_buffer(char **resp, size_t *size, size_t totlen)
+{
+	char *res;
+
+	/* Check if the user supplied buffer size is sufficient */
+	if (*size) {
+		if (*size < totlen + 1) {	/* provided buffer too small */
+			printf("Env export buffer too small: %zu, "
+				"but need %zu\n", *size, totlen + 1);
+			__set_errno(ENOMEM);
+			return NULL;
+		}
+	} else {
+		*size = totlen + 1;
+	}
+
+	/* Check if the user provided a buffer */
+	if (*resp) {
+		/* yes; clear it */
+		res = *resp;
+		memset(res, '\0', *size);
+	} else {
+		/* no, allocate and clear one */
+		*resp = res = calloc(1, *size);
+		if (res == NULL)
+			__set_errno(ENOMEM);
+	}
+
+	return res;
+}
+
+#ifdef CONFIG_ENV_EXPORT_CACHE
+static int cmpslot(const void *p1, const void *p2)
+{
+	_ENTRY *s1 = *(_ENTRY **) p1;
+	_ENTRY *s2 = *(_ENTRY **) p2;
+
+	return (strcmp(s1->entry.key, s2->entry.key));
+}
+
+/* Length of "name=value\0", with escapes */
+static size_t hexport_entry_len(const ENTRY *ep)
+{
+	const char *s;
+	size_t len = strlen(ep->key) + 2;
+
+	for (s = ep->data; *s; ++s, ++len)
+		if (*s == '\\')
+			++len;
+
+	return len;
+}
+
+/*
+ * Bring the export cache up to date and return it, or NULL if there is
+ * not enough memory for it.
+ *
+ * Usually only a variable or two changed since the last saveenv, so
+ * rather than sorting and serializing the whole table again, drop the
+ * dirty entries from the cached list, sort the dirty ones that still
+ * exist and merge them back in. Clean entries are copied over from the
+ * previous output as they are.
+ */
+static struct hexport_cache *hexport_update(struct hsearch_data *htab)
+{
+	struct hexport_cache *old = htab->cache, *c;
+	const struct hexport_item *it = NULL, *end = NULL;
+	struct hexport_item *out;
+	_ENTRY *list[htab->size];
+	size_t len = 0;
+	int i, n, kept = 0;
+	char *p;
+
+	if (old && !htab->changed)
+		return old;
+
+	/* Entries to serialize: the dirty ones, or all of them at first */
+	for (i = 1, n = 0; i <= htab->size; ++i) {
+		_ENTRY *slot = &htab->table[i];
+
+		if (slot->used > 0 && (slot->dirty || !old)) {
+			list[n++] = slot;
+			len += hexport_entry_len(&slot->entry);
+		}
+	}
+	qsort(list, n, sizeof(list[0]), cmpslot);
+
+	/* Entries to copy */
+	if (old) {
+		it = old->item;
+		end = old->item + old->n;
+		for (i = 0; i < old->n; ++i) {
+			if (!htab->table[it[i].idx].dirty) {
+				len += it[i].len;
+				++kept;
+			}
+		}
+	}
+
+	c = malloc(sizeof(*c) + (n + kept) * sizeof(c->item[0]));
+	if (c == NULL)
+		return NULL;
+	c->buf = malloc(len + 1);
+	if (c->buf == NULL) {
+		free(c);
+		return NULL;
+	}
+
+	/* Merge both lists, which are sorted by key */
+	for (i = 0, p = c->buf, out = c->item; ; ++out) {
+		while (it < end && htab->table[it->idx].dirty)
+			++it;
+		if (it == end && i == n)
+			break;
+
+		out->off = p - c->buf;
+		if (i < n && (it == end || strcmp(list[i]->entry.key,
+				htab->table[it->idx].entry.key) < 0)) {
+			out->idx = list[i] - htab->table;
+			p = hexport_entry(p, &list[i]->entry, '\0');
+			++i;
+		} else {
+			out->idx = it->idx;
+			memcpy(p, old->buf + it->off, it->len);
+			p += it->len;
+			++it;
+		}
+		out->len = p - c->buf - out->off;
+	}
+	*p = '\0';
+	c->len = p - c->buf;
+	c->n = out - c->item;
+
+	for (i = 1; i <= htab->size; ++i)
+		htab->table[i].dirty = 0;
+	htab->changed = 0;
+
+	hexport_drop_cache(htab);
+	htab->cache = c;
+
+	return c;
+}
+#endif
+
 ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char * const argv[])
@@ -602,8 +938,27 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		return (-1);
 	}
 
+	hlazy_flush(htab);
+
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, "
 		"size = %zu\n", htab, htab->size, htab->filled, size);
+
+#ifdef CONFIG_ENV_EXPORT_CACHE
+	/* A full export for external storage can come from the cache */
+	if ((sep == '\0') && (argc == 0) && !(flag & H_HIDE_DOT)) {
+		struct hexport_cache *c = hexport_update(htab);
+
+		if (c) {
+			/* pass 1 below leaves two spare bytes per entry too */
+			res = hexport_buffer(resp, &size, c->len + 2 * c->n);
+			if (res == NULL)
+				return (-1);
+			memcpy(res, c->buf, c->len);
+			return size;
+		}
+	}
+#endif
+
 	/*
 	 * Pass 1:
 	 * search used entries,
@@ -654,52 +1009,16 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	/* Sort list by keys */
 	qsort(list, n, sizeof(ENTRY *), cmpkey);
 
-	/* Check if the user supplied buffer size is sufficient */
-	if (size) {
-		if (size < totlen + 1) {	/* provided buffer too small */
-			printf("Env export buffer too small: %zu, "
-				"but need %zu\n", size, totlen + 1);
-			__set_errno(ENOMEM);
-			return (-1);
-		}
-	} else {
-		size = totlen + 1;
-	}
+	res = hexport_buffer(resp, &size, totlen);
+	if (res == NULL)
+		return (-1);
 
-	/* Check if the user provided a buffer */
-	if (*resp) {
-		/* yes; clear it */
-		res = *resp;
-		memset(res, '\0', size);
-	} else {
-		/* no, allocate and clear one */
-		*resp = res = calloc(1, size);
-		if (res == NULL) {
-			__set_errno(ENOMEM);
-			return (-1);
-		}
-	}
 	/*
 	 * Pass 2:
 	 * export sorted list of result data
 	 */
-	for (i = 0, p = res; i < n; ++i) {
-		const char *s;
-
-		s = list[i]->key;
-		while (*s)
-			*p++ = *s++;
-		*p++ = '=';
-
-		s = list[i]->data;
-
-		while (*s) {
-			if ((*s == sep) || (*s == '\\'))
-				*p++ = '\\';	/* escape */
-			*p++ = *s++;
-		}
-		*p++ = sep;
-	}
+	for (i = 0, p = res; i < n; ++i)
+		p = hexport_entry(p, list[i], sep);
 	*p = '\0';		/* terminate result */
 
 	return size;
@@ -772,6 +1091,9 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  *
  * In theory, arbitrary separator characters can be used, but only
  * '\0' and '\n' have really been tested.
+ *
+ * With H_LAZY (and CONFIG_ENV_LAZY_IMPORT), a full import only builds
+ * an index of the data; see "Lazy import" above.
  */
 
 int himport_r(struct hsearch_data *htab,
@@ -781,6 +1103,9 @@ int himport_r(struct hsearch_data *htab,
 	char *data, *sp, *dp, *name, *value;
 	char *localvars[nvars];
 	int i;
+#ifdef CONFIG_ENV_LAZY_IMPORT
+	struct hlazy *lz = NULL;
+#endif
 
 	/* Test for correct arguments.  */
 	if (htab == NULL) {
@@ -843,6 +1168,20 @@ int himport_r(struct hsearch_data *htab,
 
 	if(!size)
 		return 1;		/* everything OK */
+
+#ifdef CONFIG_ENV_LAZY_IMPORT
+	if ((flag & H_LAZY) && !(flag & H_NOCLEAR) && !nvars) {
+		lz = malloc(sizeof(*lz) + htab->size * sizeof(lz->ent[0]));
+		if (lz) {
+			lz->data = data;
+			lz->flag = flag & ~H_LAZY;
+			lz->n = 0;
+			lz->left = 0;
+			lz->busy = 0;
+		}
+	}
+#endif
+	flag &= ~H_LAZY;
 	if(crlf_is_lf) {
 		/* Remove Carriage Returns in front of Line Feeds */
 		unsigned ignored_crs = 0;
@@ -887,6 +1226,19 @@ int himport_r(struct hsearch_data *htab,
 			if (!drop_var_from_set(name, nvars, localvars))
 				continue;
 
+#ifdef CONFIG_ENV_LAZY_IMPORT
+			if (lz) {
+				for (i = 0; i < lz->n; ++i) {
+					if (lz->ent[i].key &&
+					    !strcmp(lz->ent[i].key, name)) {
+						lz->ent[i].key = NULL;
+						--lz->left;
+					}
+				}
+				continue;
+			}
+#endif
+
 			if (hdelete_r(name, htab, flag) == 0)
 				debug("DELETE ERROR ##############################\n");
 
@@ -905,6 +1257,9 @@ int himport_r(struct hsearch_data *htab,
 
 		if (*name == 0) {
 			debug("INSERT: unable to use an empty key\n");
+#ifdef CONFIG_ENV_LAZY_IMPORT
+			free(lz);
+#endif
 			__set_errno(EINVAL);
 			return 0;
 		}
@@ -913,6 +1268,23 @@ int himport_r(struct hsearch_data *htab,
 		if (!drop_var_from_set(name, nvars, localvars))
 			continue;
 
+#ifdef CONFIG_ENV_LAZY_IMPORT
+		/* or just index it */
+		if (lz) {
+			if (lz->n < htab->size) {
+				lz->ent[lz->n].hval = _hhash(name);
+				lz->ent[lz->n].key = name;
+				lz->ent[lz->n].data = value;
+				++lz->n;
+				++lz->left;
+			} else {
+				printf("himport_r: can't insert \"%s=%s\" into hash table\n",
+					name, value);
+			}
+			continue;
+		}
+#endif
+
 		/* enter into hash table */
 		e.key = name;
 		e.data = value;
@@ -927,6 +1299,17 @@ int himport_r(struct hsearch_data *htab,
 			rv, name, value);
 	} while ((dp < data + size) && *dp);	/* size check needed for text */
 						/* without '\0' termination */
+#ifdef CONFIG_ENV_LAZY_IMPORT
+	if (lz) {
+		qsort(lz->ent, lz->n, sizeof(lz->ent[0]), cmplazy);
+		if (lz->left) {
+			htab->lazy = lz;
+			data = NULL;	/* kept for later */
+		} else {
+			free(lz);
+		}
+	}
+#endif
 	debug("INSERT: free(data = %p)\n", data);
 	free(data);
 
@@ -965,6 +1348,8 @@ int hwalk_r(struct hsearch_data *htab, int (*callback)(ENTRY *))
 	int i;
 	int retval;
 
+	hlazy_flush(htab);
+
 	for (i = 1; i <= htab->size; ++i) {
 		if (htab->table[i].used > 0) {
 			retval = callback(&htab->table[i].entry);
@@ -9,6 +9,7 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
@@ -41,135 +42,118 @@ void lmb_dump_all(struct lmb *lmb)
 #endif /* DEBUG */
 }
 
-static long lmb_addrs_overlap(phys_addr_t base1,
-		phys_size_t size1, phys_addr_t base2, phys_size_t size2)
+/* Index of the first region that ends after 'addr', or cnt if none does */
+static unsigned long lmb_search(struct lmb_region *rgn, phys_addr_t addr)
 {
-	return ((base1 < (base2+size2)) && (base2 < (base1+size1)));
+	unsigned long lo = 0, hi = rgn->cnt, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rgn->region[mid].base + rgn->region[mid].size <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
 }
 
-static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
-		phys_addr_t base2, phys_size_t size2)
+static void lmb_remove_regions(struct lmb_region *rgn, unsigned long r,
+			       unsigned long n)
 {
-	if (base2 == base1 + size1)
-		return 1;
-	else if (base1 == base2 + size2)
-		return -1;
-
-	return 0;
+	memmove(&rgn->region[r], &rgn->region[r + n],
+		(rgn->cnt - r - n) * sizeof(*rgn->region));
+	rgn->cnt -= n;
 }
 
-static long lmb_regions_adjacent(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+static long lmb_insert_region(struct lmb_region *rgn, unsigned long r,
+			      phys_addr_t base, phys_size_t size)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	struct lmb_property *region;
+	unsigned long max;
+
+	if (rgn->cnt == rgn->max) {
+		max = rgn->max * 2;
+		region = malloc(max * sizeof(*region));
+		if (!region)
+			return -1;
+		memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+		if (rgn->region != rgn->initial)
+			free(rgn->region);
+		rgn->region = region;
+		rgn->max = max;
+	}
 
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+	memmove(&rgn->region[r + 1], &rgn->region[r],
+		(rgn->cnt - r) * sizeof(*rgn->region));
+	rgn->region[r].base = base;
+	rgn->region[r].size = size;
+	rgn->cnt++;
+
+	return 0;
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+static void lmb_init_region(struct lmb_region *rgn)
 {
-	unsigned long i;
+	rgn->region = rgn->initial;
+	rgn->max = MAX_LMB_REGIONS;
+	rgn->cnt = 0;
+	rgn->size = 0;
+}
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-	}
-	rgn->cnt--;
+void lmb_init(struct lmb *lmb)
+{
+	lmb_init_region(&lmb->memory);
+	lmb_init_region(&lmb->reserved);
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+static void lmb_release_region(struct lmb_region *rgn)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	if (rgn->region && rgn->region != rgn->initial)
+		free(rgn->region);
+	rgn->region = NULL;
 }
 
-void lmb_init(struct lmb *lmb)
+/* Free what lmb_init() and the calls since took; 'lmb' may be all zeroes */
+void lmb_release(struct lmb *lmb)
 {
-	/* Create a dummy zero size LMB which will get coalesced away later.
-	 * This simplifies the lmb_add() code below...
-	 */
-	lmb->memory.region[0].base = 0;
-	lmb->memory.region[0].size = 0;
-	lmb->memory.cnt = 1;
-	lmb->memory.size = 0;
-
-	/* Ditto. */
-	lmb->reserved.region[0].base = 0;
-	lmb->reserved.region[0].size = 0;
-	lmb->reserved.cnt = 1;
-	lmb->reserved.size = 0;
+	lmb_release_region(&lmb->memory);
+	lmb_release_region(&lmb->reserved);
 }
 
-/* This routine called with relocation disabled. */
+/*
+ * Add a region, merging it with any it overlaps or touches. Returns 0 if
+ * it went in by itself, the number of regions it was merged with, or -1
+ * if the table could not grow.
+ */
 static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
+	phys_addr_t end = base + size, rgnend;
+	unsigned long i, j;
 
-	if ((rgn->cnt == 1) && (rgn->region[0].size == 0)) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
+	if (!size)
 		return 0;
-	}
-
-	/* First try and coalesce this LMB with another. */
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-
-		if ((rgnbase == base) && (rgnsize == size))
-			/* Already have this region, so we're done */
-			return 0;
-
-		adjacent = lmb_addrs_adjacent(base,size,rgnbase,rgnsize);
-		if ( adjacent > 0 ) {
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		}
-		else if ( adjacent < 0 ) {
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		}
-	}
-
-	if ((i < rgn->cnt-1) && lmb_regions_adjacent(rgn, i, i+1) ) {
-		lmb_coalesce_regions(rgn, i, i+1);
-		coalesced++;
-	}
 
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
-		return -1;
-
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i+1].base = rgn->region[i].base;
-			rgn->region[i+1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i+1].base = base;
-			rgn->region[i+1].size = size;
-			break;
-		}
-	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-	}
-
-	rgn->cnt++;
-
-	return 0;
+	i = lmb_search(rgn, base);
+	/* The one before may end right where this starts */
+	if (i > 0 && rgn->region[i - 1].base + rgn->region[i - 1].size == base)
+		i--;
+	for (j = i; j < rgn->cnt && rgn->region[j].base <= end; j++)
+		;
+
+	if (i == j)
+		return lmb_insert_region(rgn, i, base, size);
+
+	rgnend = rgn->region[j - 1].base + rgn->region[j - 1].size;
+	if (rgnend > end)
+		end = rgnend;
+	if (rgn->region[i].base < base)
+		base = rgn->region[i].base;
+	rgn->region[i].base = base;
+	rgn->region[i].size = end - base;
+	lmb_remove_regions(rgn, i + 1, j - i - 1);
+
+	return j - i;
 }
 
 /* This routine may be called with relocation disabled. */
@@ -185,26 +169,20 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	struct lmb_region *rgn = &(lmb->reserved);
 	phys_addr_t rgnbegin, rgnend;
 	phys_addr_t end = base + size;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
+	unsigned long i;
 
 	/* Find the region where (base, size) belongs to */
-	for (i=0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
-
-	/* Didn't find the region */
+	i = lmb_search(rgn, base);
 	if (i == rgn->cnt)
 		return -1;
+	rgnbegin = rgn->region[i].base;
+	rgnend = rgnbegin + rgn->region[i].size;
+	if (base < rgnbegin || rgnend < end)
+		return -1;
 
 	/* Check to see if we are removing entire region */
 	if ((rgnbegin == base) && (rgnend == end)) {
-		lmb_remove_region(rgn, i);
+		lmb_remove_regions(rgn, i, 1);
 		return 0;
 	}
 
@@ -222,11 +200,13 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	}
 
 	/*
-	 * We need to split the entry -  adjust the current one to the
-	 * beginging of the hole and add the region after hole.
+	 * We need to split the entry - add the region after the hole, then
+	 * cut the current one back to the beginning of the hole.
 	 */
-	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region(rgn, end, rgnend - end);
+	if (lmb_insert_region(rgn, i + 1, end, rgnend - end))
+		return -1;
+	rgn->region[i].size = base - rgnbegin;
+	return 0;
 }
 
 long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
@@ -239,17 +219,9 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
-	unsigned long i;
-
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if ( lmb_addrs_overlap(base,size,rgnbase,rgnsize) ) {
-			break;
-		}
-	}
+	unsigned long i = lmb_search(rgn, base);
 
-	return (i < rgn->cnt) ? i : -1;
+	return (i < rgn->cnt && rgn->region[i].base < base + size) ? i : -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -324,15 +296,9 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	unsigned long i = lmb_search(&lmb->reserved, addr);
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
-	}
-	return 0;
+	return i < lmb->reserved.cnt && lmb->reserved.region[i].base <= addr;
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
@@ -11,6 +11,35 @@
  *  Richard Purdie <rpurdie@openedhand.com>
  */
 
+/*
+ * Copies of 4 and 8 bytes for the fast paths, which may copy a few bytes
+ * more than needed. Where the compiler may issue unaligned loads and
+ * stores they are done a word at a time; elsewhere, ARMv5 for one, a
+ * word access to an unaligned address traps or takes several instructions
+ * to emulate, so the bytes are copied one by one, unrolled.
+ */
+#if defined(__i386__) || defined(__x86_64__) || \
+	defined(__ARM_FEATURE_UNALIGNED)
+#define COPY4(dst, src)	\
+		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
+#else
+#define COPY4(dst, src)	do {			\
+		(dst)[0] = (src)[0];		\
+		(dst)[1] = (src)[1];		\
+		(dst)[2] = (src)[2];		\
+		(dst)[3] = (src)[3];		\
+	} while (0)
+#endif
+#if defined(__x86_64__)
+#define COPY8(dst, src)	\
+		put_unaligned(get_unaligned((const u64 *)(src)), (u64 *)(dst))
+#else
+#define COPY8(dst, src)	do {			\
+		COPY4(dst, src);		\
+		COPY4((dst) + 4, (src) + 4);	\
+	} while (0)
+#endif
+
 #define LZO_VERSION		0x2020
 #define LZO_VERSION_STRING	"2.02"
 #define LZO_VERSION_DATE	"Oct 17 2005"
@@ -8,12 +8,16 @@
 
 #include <common.h>
 #include <command.h>
+#include <hash.h>
 #include <net.h>
 #include "tftp.h"
 #include "bootp.h"
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 #include <flash.h>
 #endif
+#ifdef CONFIG_CMD_TFTPSTORE
+#include <malloc.h>
+#endif
 
 /* Well known TFTP port # */
 #define WELL_KNOWN_PORT	69
@@ -130,6 +134,23 @@ static char tftp_filename[MAX_LEN];
 static unsigned short TftpBlkSize = TFTP_BLOCK_SIZE;
 static unsigned short TftpBlkSizeOption = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: number of DATA blocks the server may send before
+ * waiting for an ACK. The default of 1 is plain lock-step RFC 1350.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE_OPTION CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE_OPTION 1
+#endif
+
+static unsigned short TftpWindowSize = 1;
+static unsigned short TftpWindowSizeOption = TFTP_WINDOWSIZE_OPTION;
+/* blocks received in order since the last ACK we sent */
+static unsigned short TftpWindowCount;
+/* last block number we sent an ACK for */
+static ulong	TftpLastAck;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -156,6 +177,79 @@ mcast_cleanup(void)
 
 #endif	/* CONFIG_MCAST_TFTP */
 
+#ifdef CONFIG_CMD_TFTPSTORE
+static struct tftp_sink *TftpSink;	/* where TFTP get stores, or NULL */
+static uchar *TftpSinkBuf;		/* blocks not yet passed to the sink */
+static ulong TftpSinkRoom;		/* size of TftpSinkBuf */
+static ulong TftpSinkFill;		/* bytes waiting in TftpSinkBuf */
+static ulong TftpSinkOffset;		/* bytes already passed to the sink */
+
+void tftp_set_sink(struct tftp_sink *sink)
+{
+	TftpSink = sink;
+	free(TftpSinkBuf);
+	TftpSinkBuf = NULL;
+}
+
+/* A new transfer starts, possibly after a restart; tell the sink */
+static int tftp_sink_start(void)
+{
+	ulong total = 0;
+	int err;
+
+	TftpSinkFill = 0;
+	TftpSinkOffset = 0;
+#ifdef CONFIG_TFTP_TSIZE
+	total = TftpTsize;
+#endif
+	if (!TftpSink->start)
+		return 0;
+
+	err = TftpSink->start(TftpSink, total);
+	if (err)
+		net_set_state(NETLOOP_FAIL);
+	return err;
+}
+
+/*
+ * Pass every full chunk gathered in TftpSinkBuf to the sink, or all of it
+ * at the end of the file.
+ */
+static int tftp_sink_flush(int last)
+{
+	ulong len;
+	int err;
+
+	while (TftpSinkFill >= TftpSink->size || (last && TftpSinkFill)) {
+		len = min(TftpSinkFill, TftpSink->size);
+		err = TftpSink->write(TftpSink, TftpSinkOffset, TftpSinkBuf,
+				      len);
+		if (err)
+			goto fail;
+		TftpSinkOffset += len;
+		TftpSinkFill -= len;
+		memmove(TftpSinkBuf, TftpSinkBuf + len, TftpSinkFill);
+	}
+
+	if (last && TftpSink->finish) {
+		err = TftpSink->finish(TftpSink, TftpSinkOffset);
+		if (err)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	printf("\nTFTP: writing to %s failed (%d)\n", TftpSink->name, err);
+	net_set_state(NETLOOP_FAIL);
+	return err;
+}
+
+#define tftp_sink_active()	(TftpSink != NULL)
+#else
+#define tftp_sink_active()	0
+#endif /* CONFIG_CMD_TFTPSTORE */
+
 static inline void
 store_block(int block, uchar *src, unsigned len)
 {
@@ -163,7 +257,26 @@ store_block(int block, uchar *src, unsigned len)
 	ulong newsize = offset + len;
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	int i, rc = 0;
+#endif
+
+#ifdef CONFIG_CMD_TFTPSTORE
+	if (TftpSink) {
+		/* The sink is written in order; we only get in-order blocks */
+		if (offset != TftpSinkOffset + TftpSinkFill ||
+		    TftpSinkFill + len > TftpSinkRoom) {
+			printf("\nTFTP: unexpected block %d for %s\n", block,
+			       TftpSink->name);
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		memcpy(TftpSinkBuf + TftpSinkFill, src, len);
+		TftpSinkFill += len;
+		NetBootFileXferSize = newsize;
+		return;
+	}
+#endif
 
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	for (i = 0; i < CONFIG_SYS_MAX_FLASH_BANKS; i++) {
 		/* start address in flash? */
 		if (flash_info[i].flash_id == FLASH_UNKNOWN)
@@ -185,6 +298,7 @@ store_block(int block, uchar *src, unsigned len)
 #endif /* CONFIG_SYS_DIRECT_FLASH_TFTP */
 	{
 		(void)memcpy((void *)(load_addr + offset), src, len);
+		hash_load_data((void *)(load_addr + offset), len);
 	}
 #ifdef CONFIG_MCAST_TFTP
 	if (Multicast)
@@ -201,6 +315,8 @@ static void new_transfer(void)
 	TftpLastBlock = 0;
 	TftpBlockWrap = 0;
 	TftpBlockWrapOffset = 0;
+	TftpWindowCount = 0;
+	TftpLastAck = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	TftpFinalBlock = 0;
 #endif
@@ -361,9 +477,17 @@ TftpSend(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, TftpBlkSizeOption, 0);
+
+		/* and for more than one block in flight per ACK */
+		if (TftpState == STATE_SEND_RRQ && TftpWindowSizeOption > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, TftpWindowSizeOption, 0);
 #ifdef CONFIG_MCAST_TFTP
-		/* Check all preconditions before even trying the option */
-		if (!ProhibitMcast) {
+		/*
+		 * Check all preconditions before even trying the option.
+		 * A sink is written in order, so it cannot use multicast.
+		 */
+		if (!ProhibitMcast && !tftp_sink_active()) {
 			Bitmap = malloc(Mapsize);
 			if (Bitmap && eth_get_dev()->mcast) {
 				free(Bitmap);
@@ -392,6 +516,8 @@ TftpSend(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(TftpBlock);
 		pkt = (uchar *)(s + 2);
+		TftpLastAck = TftpBlock;
+		TftpWindowCount = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (TftpWriting) {
 			int toload = TftpBlkSize;
@@ -530,6 +656,18 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 				debug("Blocksize ack: %s, %d\n",
 					(char *)pkt+i+8, TftpBlkSize);
 			}
+			if (strcmp((char *)pkt+i, "windowsize") == 0) {
+				TftpWindowSize = (unsigned short)
+					simple_strtoul((char *)pkt+i+11, NULL,
+						       10);
+				/* The server may only lower what we asked */
+				if (TftpWindowSize > TftpWindowSizeOption)
+					TftpWindowSize = TftpWindowSizeOption;
+				if (TftpWindowSize == 0)
+					TftpWindowSize = 1;
+				debug("Windowsize ack: %s, %d\n",
+					(char *)pkt+i+11, TftpWindowSize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				TftpTsize = simple_strtoul((char *)pkt+i+6,
@@ -541,6 +679,9 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		}
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len-1);
+		/* multicast clients ACK their own way */
+		if (Multicast)
+			TftpWindowSize = 1;
 		if ((Multicast) && (!MasterClient))
 			TftpState = STATE_DATA;	/* passive.. */
 		else
@@ -560,8 +701,6 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		len -= 2;
 		TftpBlock = ntohs(*(__be16 *)pkt);
 
-		update_block_number();
-
 		if (TftpState == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
 
@@ -571,13 +710,26 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			TftpState = STATE_DATA;
 			TftpRemotePort = src;
 			new_transfer();
+#ifdef CONFIG_CMD_TFTPSTORE
+			if (TftpSink && tftp_sink_start())
+				break;
+#endif
 
 #ifdef CONFIG_MCAST_TFTP
 			if (Multicast) { /* start!=1 common if mcast */
 				TftpLastBlock = TftpBlock - 1;
 			} else
 #endif
-			if (TftpBlock != 1) {	/* Assertion */
+			if (TftpBlock != 1 && TftpWindowSize > 1) {
+				/*
+				 * Block 1 of the first window was lost. ACK
+				 * block 0 again, as for any other gap below.
+				 */
+				debug("Got block %ld, expected 1\n", TftpBlock);
+				TftpBlock = 0;
+				TftpSend();
+				break;
+			} else if (TftpBlock != 1) {	/* Assertion */
 				printf("\nTFTP error: "
 				       "First block is not block 1 (%ld)\n"
 				       "Starting again\n\n",
@@ -594,6 +746,25 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			break;
 		}
 
+		if (TftpWindowSize > 1 &&
+		    TftpBlock != ((TftpLastBlock + 1) % TFTP_SEQUENCE_SIZE)) {
+			/*
+			 * A block of the window was lost or reordered. Drop
+			 * the rest of the window and ACK the last block we
+			 * have, which makes the server resend from there
+			 * (RFC 7440, section 4). One ACK per gap is enough,
+			 * a lost one is covered by the timeout.
+			 */
+			debug("Got block %ld, expected %ld\n", TftpBlock,
+			      (TftpLastBlock + 1) % TFTP_SEQUENCE_SIZE);
+			TftpBlock = TftpLastBlock;
+			if (TftpLastAck != TftpLastBlock)
+				TftpSend();
+			break;
+		}
+
+		update_block_number();
+
 		TftpLastBlock = TftpBlock;
 		TftpTimeoutCountMax = TIMEOUT_COUNT;
 		NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
@@ -629,7 +800,22 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			}
 		}
 #endif
-		TftpSend();
+		/*
+		 * With a window, only ACK its last block, or the final
+		 * (short) block of the file.
+		 */
+		if (++TftpWindowCount >= TftpWindowSize || len < TftpBlkSize)
+			TftpSend();
+
+#ifdef CONFIG_CMD_TFTPSTORE
+		/*
+		 * Write to the sink only once the ACK is out, so the server
+		 * sends the next blocks while the flash is busy. They wait
+		 * in the receive ring of the network driver meanwhile.
+		 */
+		if (TftpSink && tftp_sink_flush(len < TftpBlkSize))
+			break;
+#endif
 
 #ifdef CONFIG_MCAST_TFTP
 		if (Multicast) {
@@ -703,6 +889,10 @@ void TftpStart(enum proto_t protocol)
 	if (ep != NULL)
 		TftpTimeoutMSecs = simple_strtol(ep, NULL, 10);
 
+	ep = getenv("tftpwindowsize");
+	if (ep != NULL)
+		TftpWindowSizeOption = simple_strtol(ep, NULL, 10);
+
 	if (TftpTimeoutMSecs < 1000) {
 		printf("TFTP timeout (%ld ms) too low, "
 			"set minimum = 1000 ms\n",
@@ -710,8 +900,8 @@ void TftpStart(enum proto_t protocol)
 		TftpTimeoutMSecs = 1000;
 	}
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-		TftpBlkSizeOption, TftpTimeoutMSecs);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+		TftpBlkSizeOption, TftpWindowSizeOption, TftpTimeoutMSecs);
 
 	TftpRemoteIP = NetServerIP;
 	if (BootFile[0] == '\0') {
@@ -779,6 +969,20 @@ void TftpStart(enum proto_t protocol)
 	} else
 #endif
 	{
+#ifdef CONFIG_CMD_TFTPSTORE
+		if (TftpSink) {
+			/* Room for a full chunk plus the block overflowing it */
+			free(TftpSinkBuf);
+			TftpSinkRoom = TftpSink->size + TftpBlkSizeOption;
+			TftpSinkBuf = malloc(TftpSinkRoom);
+			if (!TftpSinkBuf) {
+				puts("TFTP: not enough memory for sink\n");
+				net_set_state(NETLOOP_FAIL);
+				return;
+			}
+			printf("Store to: %s\n", TftpSink->name);
+		} else
+#endif
 		printf("Load address: 0x%lx\n", load_addr);
 		puts("Loading: *\b");
 		TftpState = STATE_SEND_RRQ;
@@ -809,8 +1013,9 @@ void TftpStart(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(NetServerEther, 0, 6);
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -839,8 +1044,9 @@ TftpStartServer(void)
 	TftpTimeoutMSecs = TIMEOUT;
 	NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
 
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 	TftpBlock = 0;
 	TftpOurPort = WELL_KNOWN_PORT;
 
@@ -9,6 +9,7 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <div64.h>
 #include <malloc.h>
 #include <asm/io.h>
 
@@ -226,6 +227,30 @@ static int uncompress_using_lzo(void *in, unsigned long in_size,
 	return (ret != LZO_E_OK);
 }
 
+/* Feed the stream decoder in small pieces, as a storage loader would */
+static int uncompress_using_gzip_stream(void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	struct gunzip_stream *gs;
+	unsigned long pos, len, out_len;
+	int ret = 0;
+
+	gs = gunzip_stream_start(out, out_max);
+	if (!gs)
+		return -1;
+	for (pos = 0; pos < in_size && !ret; pos += len) {
+		len = min(in_size - pos, 7UL);
+		ret = gunzip_stream_feed(gs, in + pos, len);
+	}
+	if (gunzip_stream_finish(gs, &out_len) || ret < 0)
+		return -1;
+	if (out_size)
+		*out_size = out_len;
+
+	return 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -321,6 +346,8 @@ static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 	int err = 0;
 
 	err += run_test("gzip", compress_using_gzip, uncompress_using_gzip);
+	err += run_test("gzip stream", compress_using_gzip,
+			uncompress_using_gzip_stream);
 	err += run_test("bzip2", compress_using_bzip2, uncompress_using_bzip2);
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
@@ -416,3 +443,174 @@ U_BOOT_CMD(
 	ut_image_decomp,	5,	1, do_ut_image_decomp,
 	"Basic test of bootm decompression", ""
 );
+
+/*
+ * Throughput of lzo1x_decompress_safe() against the byte-copy decoder it
+ * replaced. There is no LZO compressor in U-Boot, so the input is made up
+ * here: raw LZO1X streams of literal runs and matches of random lengths
+ * and distances, along with the data they decode to.
+ */
+#define LZO_BENCH_SIZE	(1 << 20)
+#define LZO_BENCH_MS	1000
+
+/* The decoder lib/lzo had before, in lzo_ref.c */
+int lzo1x_decompress_ref(const unsigned char *in, size_t in_len,
+			 unsigned char *out, size_t *out_len);
+
+struct lzo_decoder {
+	const char *name;
+	int (*decompress)(const unsigned char *in, size_t in_len,
+			  unsigned char *out, size_t *out_len);
+};
+
+static const struct lzo_decoder lzo_decoders[] = {
+	{ "new", lzo1x_decompress_safe },
+	{ "old", lzo1x_decompress_ref },
+};
+
+static u32 lzo_seed;
+
+static u32 lzo_rand(void)
+{
+	lzo_seed = lzo_seed * 1103515245 + 12345;
+
+	return lzo_seed >> 8;
+}
+
+/* The part of a run length that does not fit the instruction byte */
+static u8 *lzo_put_len(u8 *op, size_t len)
+{
+	while (len > 255) {
+		*op++ = 0;
+		len -= 255;
+	}
+	*op++ = len;
+
+	return op;
+}
+
+/*
+ * Write a stream to 'out' that decodes to close to 'size' bytes, which are
+ * written to 'plain'. Literal runs are up to 'lit_max' bytes long and
+ * matches up to 'match_max' bytes, at most 16 KiB back. Returns the length
+ * of the stream; the decoded length is stored in *plain_len.
+ */
+static size_t lzo_make_stream(u8 *out, u8 *plain, size_t size, uint lit_max,
+			      uint match_max, size_t *plain_len)
+{
+	u8 *op = out, *lit_bits = NULL;
+	size_t pos = 0, lit, len, dist, i;
+
+	/* The stream must start with a run of at least 4 literals */
+	lit = 4 + lzo_rand() % lit_max;
+	while (pos + lit + match_max < size) {
+		/* Up to 3 literals are counted in the match before them */
+		if (lit && lit <= 3 && lit_bits) {
+			*lit_bits |= lit;
+		} else if (lit > 3 && lit <= 18) {
+			*op++ = lit - 3;
+		} else if (lit > 18) {
+			*op++ = 0;
+			op = lzo_put_len(op, lit - 18);
+		}
+		for (i = 0; i < lit; i++)
+			plain[pos++] = *op++ = lzo_rand();
+
+		/* A match with a 14-bit distance */
+		len = 3 + lzo_rand() % (match_max - 2);
+		dist = 1 + lzo_rand() % min(pos, (size_t)0x4000);
+		if (len <= 33) {
+			*op++ = 32 | (len - 2);
+		} else {
+			*op++ = 32;
+			op = lzo_put_len(op, len - 33);
+		}
+		lit_bits = op;
+		*op++ = (dist - 1) << 2;
+		*op++ = (dist - 1) >> 6;
+		for (i = 0; i < len; i++, pos++)
+			plain[pos] = plain[pos - dist];
+
+		lit = lzo_rand() % lit_max;
+	}
+
+	/* End of stream */
+	*op++ = 16 | 1;
+	*op++ = 0;
+	*op++ = 0;
+	*plain_len = pos;
+
+	return op - out;
+}
+
+static int run_lzo_bench(const char *name, uint lit_max, uint match_max)
+{
+	const struct lzo_decoder *dec;
+	size_t in_len, plain_len, out_len;
+	u8 *in, *plain, *out;
+	ulong start, ms;
+	u64 bytes;
+	int i, ret = 0;
+
+	in = malloc(2 * LZO_BENCH_SIZE);
+	plain = malloc(LZO_BENCH_SIZE);
+	out = malloc(LZO_BENCH_SIZE + 1);
+	errcheck(in && plain && out);
+
+	lzo_seed = 1;
+	in_len = lzo_make_stream(in, plain, LZO_BENCH_SIZE, lit_max, match_max,
+				 &plain_len);
+	printf(" %s: %zu bytes from %zu\n", name, plain_len, in_len);
+
+	for (i = 0; i < ARRAY_SIZE(lzo_decoders); i++) {
+		dec = &lzo_decoders[i];
+
+		/* Stops at the end of the buffer, even one byte short */
+		out[plain_len - 1] = 'A';
+		out_len = plain_len - 1;
+		errcheck(dec->decompress(in, in_len, out, &out_len) ==
+			 LZO_E_OUTPUT_OVERRUN);
+		errcheck(out[plain_len - 1] == 'A');
+
+		bytes = 0;
+		start = get_timer(0);
+		do {
+			out_len = plain_len;
+			ret = dec->decompress(in, in_len, out, &out_len);
+			bytes += out_len;
+			ms = get_timer(start);
+		} while (ret == LZO_E_OK && ms < LZO_BENCH_MS);
+		errcheck(ret == LZO_E_OK);
+		errcheck(out_len == plain_len);
+		errcheck(memcmp(out, plain, plain_len) == 0);
+
+		bytes *= 1000;
+		do_div(bytes, ms ? ms : 1);
+		printf("\t%s: %lu KiB/s\n", dec->name, (ulong)bytes / 1024);
+	}
+
+out:
+	free(out);
+	free(plain);
+	free(in);
+
+	return ret;
+}
+
+static int do_ut_lzo(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	int err = 0;
+
+	/* Short runs, as in text and code, then long ones */
+	err |= run_lzo_bench("short runs", 8, 16);
+	err |= run_lzo_bench("long runs", 64, 256);
+
+	printf("ut_lzo %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_lzo,	1,	1,	do_ut_lzo,
+	"Compare the LZO decompressor with the one it replaced", ""
+);
@@ -0,0 +1,201 @@
+/*
+ * Tests for the mxs_dcp driver against the sandbox model of the DCP
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <hash.h>
+#include <aes.h>
+#include <malloc.h>
+#include <asm/test.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* Not a multiple of the SHA block size nor of the driver's AES chunk */
+#define TEST_SIZE	5008
+
+static const u8 sha1_abc[SHA1_SUM_LEN] = {
+	0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d,
+};
+
+static const u8 sha256_abc[SHA256_SUM_LEN] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+/* FIPS-197 appendix C.1; one CBC block with a zero IV is plain AES */
+static const u8 aes_key[AES_KEY_LENGTH] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+
+static const u8 aes_plain[AES_KEY_LENGTH] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+};
+
+static const u8 aes_cipher[AES_KEY_LENGTH] = {
+	0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+	0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+};
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+/* Hash buf in pieces of the given sizes, the last one running to the end */
+static int hash_progressive(struct hash_algo *algo, const u8 *buf, uint len,
+			    const uint *sizes, int last_flag, u8 *out)
+{
+	void *ctx;
+	uint off, n;
+	int ret;
+
+	ret = algo->hash_init(algo, &ctx);
+	for (off = 0; !ret && off < len; off += n) {
+		n = *sizes ? min(*sizes++, len - off) : len - off;
+		ret = algo->hash_update(algo, ctx, buf + off, n,
+					last_flag && off + n == len);
+	}
+	if (ret)
+		return ret;
+
+	return algo->hash_finish(algo, ctx, out, HASH_MAX_DIGEST_SIZE);
+}
+
+static int run_hash_test(const char *name, const u8 *abc_sum, u8 *buf)
+{
+	static const uint splits[][5] = {
+		{ 0 },
+		{ 1, 63, 64, 65, 0 },
+		{ 64, 64, 0 },
+		{ 100, 1000, 7, 0 },
+	};
+	void (*sw)(const unsigned char *, unsigned int, unsigned char *,
+		   unsigned int);
+	u8 ref[HASH_MAX_DIGEST_SIZE], sum[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int i, last, packets;
+	int ret;
+
+	printf(" testing %s ...\n", name);
+	sw = strcmp(name, "sha1") ? sha256_csum_wd : sha1_csum_wd;
+
+	errcheck(hash_lookup_algo(name, &algo) == 0);
+	errcheck(hash_progressive_lookup_algo(name, &algo) == 0);
+
+	packets = sandbox_dcp_packet_count();
+	memcpy(buf, "abc", 3);
+	algo->hash_func_ws(buf, 3, sum, algo->chunk_size);
+	errcheck(memcmp(sum, abc_sum, algo->digest_size) == 0);
+	errcheck(sandbox_dcp_packet_count() > packets);
+
+	/* Several packets, and a source that is not aligned */
+	sw(buf + 1, TEST_SIZE - 1, ref, algo->chunk_size);
+	algo->hash_func_ws(buf + 1, TEST_SIZE - 1, sum, 1024);
+	errcheck(memcmp(sum, ref, algo->digest_size) == 0);
+
+	for (i = 0; i < ARRAY_SIZE(splits); i++) {
+		for (last = 0; last < 2; last++) {
+			memset(sum, 0, sizeof(sum));
+			errcheck(hash_progressive(algo, buf + 1, TEST_SIZE - 1,
+						  splits[i], last, sum) == 0);
+			errcheck(memcmp(sum, ref, algo->digest_size) == 0);
+		}
+	}
+
+	/* The engine cannot hash nothing; the driver must cope */
+	sw(buf, 0, ref, algo->chunk_size);
+	errcheck(hash_progressive(algo, buf, 0, splits[0], 1, sum) == 0);
+	errcheck(memcmp(sum, ref, algo->digest_size) == 0);
+	ret = 0;
+
+out:
+	printf(" %s: %s\n", name, ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+static int run_aes_test(u8 *buf)
+{
+	u8 key_exp[AES_EXPAND_KEY_LENGTH];
+	u8 *plain, *cipher, *ref, *out;
+	u8 chain[AES_KEY_LENGTH] = { 0 };
+	uint blocks = TEST_SIZE / AES_KEY_LENGTH;
+	int i, packets;
+	int ret;
+
+	printf(" testing aes ...\n");
+	plain = buf;
+	cipher = buf + TEST_SIZE + 1;		/* deliberately unaligned */
+	ref = cipher + TEST_SIZE;
+	out = ref + TEST_SIZE;
+
+	memcpy(out, aes_key, sizeof(aes_key));
+	aes_expand_key(out, key_exp);
+	memcpy(out, aes_plain, sizeof(aes_plain));
+	packets = sandbox_dcp_packet_count();
+	aes_cbc_encrypt_blocks(key_exp, out, cipher, 1);
+	errcheck(memcmp(cipher, aes_cipher, sizeof(aes_cipher)) == 0);
+	errcheck(sandbox_dcp_packet_count() > packets);
+
+	/* Reference CBC built from the single-block primitive */
+	for (i = 0; i < blocks; i++) {
+		aes_apply_cbc_chain_data(chain, plain + i * AES_KEY_LENGTH,
+					 chain);
+		aes_encrypt(chain, key_exp, ref + i * AES_KEY_LENGTH);
+		memcpy(chain, ref + i * AES_KEY_LENGTH, AES_KEY_LENGTH);
+	}
+
+	aes_cbc_encrypt_blocks(key_exp, plain, cipher, blocks);
+	errcheck(memcmp(cipher, ref, blocks * AES_KEY_LENGTH) == 0);
+	aes_cbc_decrypt_blocks(key_exp, cipher, out, blocks);
+	errcheck(memcmp(out, plain, blocks * AES_KEY_LENGTH) == 0);
+
+	/* In place, as the environment does it */
+	aes_cbc_decrypt_blocks(key_exp, cipher, cipher, blocks);
+	errcheck(memcmp(cipher, plain, blocks * AES_KEY_LENGTH) == 0);
+	ret = 0;
+
+out:
+	printf(" aes: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+static int do_ut_dcp(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char *const argv[])
+{
+	u8 *buf;
+	int i, err = 0;
+
+	/* The model can only reach memory inside the sandbox RAM */
+	buf = malloc(4 * TEST_SIZE + 1);
+	if (!buf)
+		return CMD_RET_FAILURE;
+	for (i = 0; i < TEST_SIZE; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	err += run_hash_test("sha1", sha1_abc, buf);
+	err += run_hash_test("sha256", sha256_abc, buf);
+	for (i = 0; i < TEST_SIZE; i++)
+		buf[i] = i * 7 + (i >> 8);
+	err += run_aes_test(buf);
+	free(buf);
+
+	printf("ut_dcp %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_dcp,	1,	1,	do_ut_dcp,
+	"Test the DCP driver against the sandbox model", ""
+);
@@ -0,0 +1,103 @@
+/*
+ * Tests for loading the environment
+ *
+ * Imports an environment that binds variables through ".callbacks" and
+ * ".flags" among many others. With CONFIG_ENV_LAZY_IMPORT, entering either
+ * of those walks the table from inside the lazy import, which must then
+ * enter everything that is left. Afterwards each variable must have its
+ * value and the bindings must be in effect. The environment from before is
+ * imported again at the end.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <environment.h>
+#include <malloc.h>
+#include <search.h>
+#include <u-boot/crc.h>
+
+/* Variables before and after the bindings, so some are left for the walk */
+#define NVARS		200
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+static void make_env(env_t *env)
+{
+	char *p = (char *)env->data;
+	int i;
+
+	memset(env, '\0', sizeof(*env));
+	for (i = 0; i < NVARS; i++) {
+		if (i == NVARS / 2) {
+			p += sprintf(p, "%s=ut_env_addr:loadaddr",
+				     ENV_CALLBACK_VAR) + 1;
+			p += sprintf(p, "%s=ut_env_ro:sr", ENV_FLAGS_VAR) + 1;
+			p += sprintf(p, "ut_env_addr=100") + 1;
+			p += sprintf(p, "ut_env_ro=fixed") + 1;
+		}
+		p += sprintf(p, "ut_env%d=%d", i, i * 7) + 1;
+	}
+	env->crc = crc32(0, env->data, ENV_SIZE);
+}
+
+static int test_import(env_t *env)
+{
+	char name[16];
+	int i, ret = 0;
+
+	make_env(env);
+	errcheck(env_import((char *)env, 1) == 1);
+
+	for (i = 0; i < NVARS; i++) {
+		sprintf(name, "ut_env%d", i);
+		errcheck(getenv_ulong(name, 10, -1) == i * 7);
+	}
+#ifdef CONFIG_ENV_LAZY_IMPORT
+	errcheck(env_htab.lazy == NULL);
+#endif
+	errcheck(env_htab.filled == NVARS + 4);
+
+	/* ut_env_addr now sets the load address, ut_env_ro is read-only */
+	errcheck(setenv("ut_env_addr", "1234") == 0);
+	errcheck(load_addr == 0x1234);
+	errcheck(setenv("ut_env_ro", "changed") != 0);
+	errcheck(!strcmp(getenv("ut_env_ro"), "fixed"));
+
+out:
+	return ret;
+}
+
+static int do_ut_env(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	ulong addr = load_addr;
+	env_t *env, *saved;
+	int err = 1;
+
+	env = malloc(sizeof(*env));
+	saved = malloc(sizeof(*saved));
+	if (!env || !saved || env_export(saved))
+		goto out;
+
+	err = test_import(env);
+
+	env_import((char *)saved, 1);
+	load_addr = addr;
+out:
+	free(saved);
+	free(env);
+	printf("ut_env %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_env,	1,	1,	do_ut_env,
+	"Test importing an environment with callback and flags bindings",
+	""
+);
@@ -0,0 +1,216 @@
+/*
+ * Tests for the lmb region tables
+ *
+ * Reserves more regions than the table starts out with, in random order,
+ * and checks that they stay sorted, that touching and overlapping ones
+ * are merged and that lmb_free(), lmb_alloc() and lmb_is_reserved() see
+ * them right. Then times a large number of reservations, as a device
+ * tree with many /memreserve/ entries and reserved-memory nodes makes.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <lmb.h>
+#include <malloc.h>
+
+#define RAM_BASE	0x40000000
+#define RAM_SIZE	(256 << 20)
+
+/* Regions reserved by the first test, one every STRIDE bytes */
+#define NREGIONS	100
+#define STRIDE		0x10000
+#define RSV_SIZE	0x1000
+
+/* Regions reserved when timing */
+#define BENCH_REGIONS	4000
+
+/* Fill 'order' with 0..n-1, shuffled */
+static void shuffle(uint *order, uint n)
+{
+	uint i, j, t;
+
+	for (i = 0; i < n; i++)
+		order[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+}
+
+static int check_sorted(struct lmb_region *rgn)
+{
+	unsigned long i;
+
+	for (i = 1; i < rgn->cnt; i++) {
+		if (rgn->region[i - 1].base + rgn->region[i - 1].size >=
+		    rgn->region[i].base) {
+			printf(" regions %lu and %lu overlap or touch\n",
+			       i - 1, i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+static phys_addr_t rsv_base(uint i)
+{
+	return RAM_BASE + (phys_addr_t)i * STRIDE;
+}
+
+static int test_reserve(struct lmb *lmb, uint *order)
+{
+	struct lmb_region *rgn = &lmb->reserved;
+	phys_addr_t base;
+	uint i;
+	int ret = 0;
+
+	shuffle(order, NREGIONS);
+	for (i = 0; i < NREGIONS; i++)
+		errcheck(lmb_reserve(lmb, rsv_base(order[i]), RSV_SIZE) >= 0);
+	errcheck(rgn->cnt == NREGIONS);
+	errcheck(rgn->region != rgn->initial);
+	errcheck(!check_sorted(rgn));
+
+	for (i = 0; i < NREGIONS; i++) {
+		base = rsv_base(i);
+		errcheck(lmb_is_reserved(lmb, base));
+		errcheck(lmb_is_reserved(lmb, base + RSV_SIZE - 1));
+		errcheck(!lmb_is_reserved(lmb, base + RSV_SIZE));
+		errcheck(!lmb_is_reserved(lmb, base - 1));
+	}
+
+	/* The same region again changes nothing */
+	errcheck(lmb_reserve(lmb, rsv_base(7), RSV_SIZE) >= 0);
+	errcheck(rgn->cnt == NREGIONS);
+
+	/* Fill the gap after region 10 exactly: 10, 11 and the gap merge */
+	errcheck(lmb_reserve(lmb, rsv_base(10) + RSV_SIZE,
+			     STRIDE - RSV_SIZE) == 2);
+	errcheck(rgn->cnt == NREGIONS - 1);
+	errcheck(rgn->region[10].base == rsv_base(10));
+	errcheck(rgn->region[10].size == STRIDE + RSV_SIZE);
+
+	/* One overlapping regions 20 to 25 swallows them */
+	errcheck(lmb_reserve(lmb, rsv_base(20) + 0x800, 5 * STRIDE) == 6);
+	errcheck(rgn->cnt == NREGIONS - 6);
+	errcheck(lmb_is_reserved(lmb, rsv_base(23) - 1));
+	errcheck(!check_sorted(rgn));
+
+	/* Punch a hole into the merged region 10/11 */
+	base = rsv_base(10) + STRIDE / 2;
+	errcheck(lmb_free(lmb, base, RSV_SIZE) == 0);
+	errcheck(rgn->cnt == NREGIONS - 5);
+	errcheck(!lmb_is_reserved(lmb, base));
+	errcheck(lmb_is_reserved(lmb, base - 1));
+	errcheck(lmb_is_reserved(lmb, base + RSV_SIZE));
+
+	/* Free the front, the back and all of a region, and a bad range */
+	errcheck(lmb_free(lmb, rsv_base(40), 0x100) == 0);
+	errcheck(!lmb_is_reserved(lmb, rsv_base(40)));
+	errcheck(lmb_free(lmb, rsv_base(41) + RSV_SIZE - 0x100, 0x100) == 0);
+	errcheck(!lmb_is_reserved(lmb, rsv_base(41) + RSV_SIZE - 1));
+	errcheck(lmb_free(lmb, rsv_base(42), RSV_SIZE) == 0);
+	errcheck(rgn->cnt == NREGIONS - 6);
+	errcheck(lmb_free(lmb, rsv_base(42), RSV_SIZE) == -1);
+	errcheck(lmb_free(lmb, rsv_base(43), STRIDE) == -1);
+	errcheck(!check_sorted(rgn));
+
+out:
+	return ret;
+}
+
+static int test_alloc(struct lmb *lmb)
+{
+	phys_addr_t addr, max = rsv_base(NREGIONS / 2);
+	int ret = 0;
+
+	/* Only the gaps between the reserved regions are free below 'max' */
+	addr = lmb_alloc_base(lmb, STRIDE - RSV_SIZE, RSV_SIZE, max);
+	errcheck(addr == rsv_base(NREGIONS / 2 - 1) + RSV_SIZE);
+	errcheck(lmb_is_reserved(lmb, addr));
+	errcheck(!check_sorted(&lmb->reserved));
+
+	/* Too big for any gap below 'max' */
+	errcheck(!__lmb_alloc_base(lmb, 4 * STRIDE, RSV_SIZE, max));
+
+	/* Anywhere: goes to the top of RAM */
+	addr = lmb_alloc(lmb, 0x100000, 0x100000);
+	errcheck(addr == RAM_BASE + RAM_SIZE - 0x100000);
+
+out:
+	return ret;
+}
+
+static int test_bench(struct lmb *lmb, uint *order)
+{
+	ulong start, us;
+	uint i;
+	int ret = 0;
+
+	shuffle(order, BENCH_REGIONS);
+	start = timer_get_us();
+	for (i = 0; i < BENCH_REGIONS; i++)
+		errcheck(lmb_reserve(lmb, RAM_BASE + order[i] * 0x2000ULL,
+				     0x1000) >= 0);
+	for (i = 0; i < BENCH_REGIONS; i++)
+		errcheck(lmb_is_reserved(lmb, RAM_BASE + i * 0x2000ULL));
+	us = timer_get_us() - start;
+
+	errcheck(lmb->reserved.cnt == BENCH_REGIONS);
+	errcheck(!check_sorted(&lmb->reserved));
+	printf(" %u reservations and lookups in %lu us\n", BENCH_REGIONS, us);
+
+out:
+	return ret;
+}
+
+static int do_ut_lmb(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct lmb *lmb;
+	uint *order;
+	int err = 1;
+
+	lmb = calloc(1, sizeof(*lmb));
+	order = malloc(BENCH_REGIONS * sizeof(*order));
+	if (!lmb || !order)
+		goto out;
+
+	srand(1);
+	lmb_init(lmb);
+	if (lmb_add(lmb, RAM_BASE, RAM_SIZE) < 0)
+		goto out;
+	err = test_reserve(lmb, order);
+	if (!err)
+		err = test_alloc(lmb);
+	lmb_release(lmb);
+
+	if (!err) {
+		lmb_init(lmb);
+		err = test_bench(lmb, order);
+		lmb_release(lmb);
+	}
+
+out:
+	free(order);
+	free(lmb);
+	printf("ut_lmb %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_lmb,	1,	1,	do_ut_lmb,
+	"Test the lmb region tables",
+	""
+);
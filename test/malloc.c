@@ -0,0 +1,219 @@
+/*
+ * Replay an allocation trace through malloc() and through dlmalloc alone
+ *
+ * A trace is a list of records of two 32-bit words, a slot and a size:
+ * the size is allocated and kept in the slot, or, if it is TRACE_FREE,
+ * what the slot holds is freed. One can be loaded into memory and given
+ * as 'ut_malloc <addr> <count>'; without arguments a built-in trace is
+ * used, made up the way a UBIFS mount allocates: mostly small nodes,
+ * some larger buffers, each freed again at some random later point.
+ *
+ * Every block is marked when it is allocated and checked when it is
+ * freed, so blocks that overlap show up as errors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <malloc.h>
+#include <watchdog.h>
+
+#define TRACE_FREE	0xffffffff
+#define TRACE_SLOTS	4096
+
+/* Records in the built-in trace */
+#define TRACE_LEN	20000
+
+/* Replay with each allocator for at least this long */
+#define BENCH_MS	1000
+
+struct trace_rec {
+	u32 slot;
+	u32 size;
+};
+
+struct allocator {
+	const char *name;
+	void *(*alloc)(size_t bytes);
+	void (*free)(void *mem);
+};
+
+static const struct allocator allocators[] = {
+	{ "malloc", malloc, free },
+	{ "dlmalloc", dlmalloc, dlfree },
+};
+
+static u32 trace_size(void)
+{
+	u32 r = rand() % 100;
+
+	/* znodes, LEB properties and the like, then buffers */
+	if (r < 60)
+		return 16 + rand() % 112;
+	if (r < 95)
+		return 128 + rand() % 128;
+
+	return 512 << (rand() % 4);
+}
+
+static void make_trace(struct trace_rec *rec)
+{
+	u8 used[TRACE_SLOTS];
+	uint i, slot;
+
+	srand(1);
+	memset(used, 0, sizeof(used));
+	for (i = 0; i < TRACE_LEN; i++) {
+		slot = rand() % TRACE_SLOTS;
+		rec[i].slot = slot;
+		if (used[slot]) {
+			rec[i].size = TRACE_FREE;
+			used[slot] = 0;
+		} else {
+			rec[i].size = trace_size();
+			used[slot] = 1;
+		}
+	}
+}
+
+static void mark(u8 *mem, u32 size, uint slot)
+{
+	if (size) {
+		mem[0] = slot;
+		mem[size - 1] = slot >> 8;
+	}
+}
+
+static int check(const u8 *mem, u32 size, uint slot)
+{
+	if (size && (mem[0] != (u8)slot || mem[size - 1] != (u8)(slot >> 8))) {
+		printf(" block in slot %u was overwritten\n", slot);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Returns the number of errors */
+static int replay(const struct allocator *a, const struct trace_rec *rec,
+		  uint count, void **slot, u32 *len)
+{
+	uint i, s;
+	int err = 0;
+
+	for (i = 0; i < count; i++) {
+		s = rec[i].slot;
+		if (slot[s]) {
+			err += check(slot[s], len[s], s);
+			a->free(slot[s]);
+			slot[s] = NULL;
+		}
+		if (rec[i].size == TRACE_FREE)
+			continue;
+
+		len[s] = rec[i].size;
+		slot[s] = a->alloc(len[s]);
+		if (!slot[s]) {
+			printf(" out of memory at record %u\n", i);
+			err++;
+			break;
+		}
+		mark(slot[s], len[s], s);
+	}
+
+	/* Whatever the trace left allocated */
+	for (s = 0; s < TRACE_SLOTS; s++) {
+		if (slot[s]) {
+			err += check(slot[s], len[s], s);
+			a->free(slot[s]);
+			slot[s] = NULL;
+		}
+	}
+
+	return err;
+}
+
+static int run_bench(const struct allocator *a, const struct trace_rec *rec,
+		     uint count, void **slot, u32 *len)
+{
+	ulong start, ms, top = mem_malloc_brk;
+	u64 ops = 0;
+	int err;
+
+	start = get_timer(0);
+	do {
+		err = replay(a, rec, count, slot, len);
+		ops += count;
+		WATCHDOG_RESET();
+		ms = get_timer(start);
+	} while (!err && ms < BENCH_MS);
+
+	if (!err) {
+		ops *= 1000;
+		do_div(ops, ms ? ms : 1);
+		printf(" %-10s %9lu ops/s, heap top moved by %ld KiB\n",
+		       a->name, (ulong)ops,
+		       (long)(mem_malloc_brk - top) / 1024);
+	}
+
+	return err;
+}
+
+static int do_ut_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct trace_rec *rec, *trace = NULL;
+	uint i, count = TRACE_LEN;
+	void **slot;
+	u32 *len;
+	int err = 0;
+
+	if (argc == 3) {
+		rec = (struct trace_rec *)simple_strtoul(argv[1], NULL, 16);
+		count = simple_strtoul(argv[2], NULL, 0);
+		for (i = 0; i < count; i++) {
+			if (rec[i].slot >= TRACE_SLOTS) {
+				printf("Record %u: slot %u out of range\n", i,
+				       rec[i].slot);
+				return CMD_RET_FAILURE;
+			}
+		}
+	} else if (argc == 1) {
+		trace = malloc(TRACE_LEN * sizeof(*trace));
+		if (!trace)
+			return CMD_RET_FAILURE;
+		make_trace(trace);
+		rec = trace;
+	} else {
+		return CMD_RET_USAGE;
+	}
+
+	slot = calloc(TRACE_SLOTS, sizeof(*slot));
+	len = malloc(TRACE_SLOTS * sizeof(*len));
+	if (!slot || !len) {
+		err = 1;
+		goto out;
+	}
+
+	printf(" replaying %u records:\n", count);
+	for (i = 0; i < ARRAY_SIZE(allocators) && !err; i++)
+		err = run_bench(&allocators[i], rec, count, slot, len);
+	malloc_slab_stats();
+
+out:
+	free(len);
+	free(slot);
+	free(trace);
+	printf("ut_malloc %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_malloc,	3,	1,	do_ut_malloc,
+	"Replay an allocation trace through malloc() and dlmalloc",
+	"[<addr> <count>] - replay 'count' records at 'addr' instead of\n"
+	"    the built-in trace"
+);
@@ -0,0 +1,324 @@
+#!/usr/bin/python
+#
+# Minimal TFTP server with RFC 7440 windowsize support, used to check and
+# measure the windowed TFTP client in net/tftp.c.
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+# Serve a file to a board (every read request gets the same file):
+#
+#   ./test/net/tftpd_window.py -f u-boot.img -p 6969
+#
+# and on the target:
+#
+#   setenv tftpdstp 6969 (needs CONFIG_TFTP_PORT)
+#   setenv tftpwindowsize 8
+#   tftp ${loadaddr} u-boot.img
+#
+# Each transfer prints the negotiated options and the throughput.
+#
+# Loopback mode runs a reference client, which follows the same ACK rules as
+# net/tftp.c, against the server on 127.0.0.1 for several window sizes:
+#
+#   ./test/net/tftpd_window.py --loopback -s 8M --drop 0.01 --reorder 0.01
+
+from __future__ import print_function
+
+from optparse import OptionParser
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+TFTP_RRQ = 1
+TFTP_DATA = 3
+TFTP_ACK = 4
+TFTP_ERROR = 5
+TFTP_OACK = 6
+
+SEQUENCE_SIZE = 1 << 16
+
+
+def parse_size(text):
+    """Parse a size with an optional K/M suffix
+
+    >>> parse_size('4M')
+    4194304
+    """
+    mult = {'k': 1 << 10, 'm': 1 << 20}.get(text[-1].lower(), 1)
+    if mult != 1:
+        text = text[:-1]
+    return int(text, 0) * mult
+
+
+def parse_rrq(pkt):
+    """Return the file name and options of a read request"""
+    fields = pkt[2:].split(b'\0')
+    name = fields[0].decode()
+    options = {}
+    for i in range(2, len(fields) - 1, 2):
+        options[fields[i].decode().lower()] = fields[i + 1].decode()
+    return name, options
+
+
+class Server(object):
+    """Serve one transfer at a time, injecting loss and reordering"""
+
+    def __init__(self, data, addr, port, drop=0.0, reorder=0.0,
+                 timeout=1.0, quiet=False):
+        self.data = data
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((addr, port))
+        self.port = self.sock.getsockname()[1]
+        self.drop = drop
+        self.reorder = reorder
+        self.timeout = timeout
+        self.quiet = quiet
+        self.results = []
+
+    def serve_forever(self, count=None):
+        while count is None or count > 0:
+            pkt, peer = self.sock.recvfrom(65536)
+            if struct.unpack('>H', pkt[:2])[0] != TFTP_RRQ:
+                continue
+            self.transfer(pkt, peer)
+            if count is not None:
+                count -= 1
+
+    def send_window(self, sock, peer, blocks):
+        """Send a list of DATA packets, dropping or swapping some"""
+        pending = None
+        for pkt in blocks:
+            if random.random() < self.drop:
+                continue
+            if pending is None and random.random() < self.reorder:
+                pending = pkt
+                continue
+            sock.sendto(pkt, peer)
+            if pending is not None:
+                sock.sendto(pending, peer)
+                pending = None
+        if pending is not None:
+            sock.sendto(pending, peer)
+
+    def transfer(self, rrq, peer):
+        name, options = parse_rrq(rrq)
+        blksize = 512
+        windowsize = 1
+        oack = []
+        if 'blksize' in options:
+            blksize = min(int(options['blksize']), 65464)
+            oack += ['blksize', str(blksize)]
+        if 'windowsize' in options:
+            windowsize = max(1, min(int(options['windowsize']), 65535))
+            oack += ['windowsize', str(windowsize)]
+        if 'tsize' in options:
+            oack += ['tsize', str(len(self.data))]
+        if 'timeout' in options:
+            oack += ['timeout', options['timeout']]
+
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind((self.sock.getsockname()[0], 0))
+        sock.settimeout(self.timeout)
+
+        nblocks = len(self.data) // blksize + 1
+        start = time.time()
+        resent = 0
+
+        # Block 0 is the OACK, acknowledged like a data block
+        if oack:
+            pkt = struct.pack('>H', TFTP_OACK) + \
+                b''.join(o.encode() + b'\0' for o in oack)
+            acked = -1
+            for retry in range(10):
+                sock.sendto(pkt, peer)
+                try:
+                    ack = sock.recv(65536)
+                except socket.timeout:
+                    continue
+                if struct.unpack('>HH', ack[:4]) == (TFTP_ACK, 0):
+                    acked = 0
+                    break
+            if acked:
+                sock.close()
+                return
+        acked = 0
+
+        while acked < nblocks:
+            last = min(acked + windowsize, nblocks)
+            window = []
+            for block in range(acked + 1, last + 1):
+                chunk = self.data[(block - 1) * blksize:block * blksize]
+                window.append(struct.pack('>HH', TFTP_DATA,
+                                          block % SEQUENCE_SIZE) + chunk)
+            self.send_window(sock, peer, window)
+
+            # Wait for an ACK within the window; anything else is stale
+            deadline = time.time() + self.timeout
+            got = None
+            while time.time() < deadline:
+                try:
+                    ack = sock.recv(65536)
+                except socket.timeout:
+                    break
+                op, seq = struct.unpack('>HH', ack[:4])
+                if op != TFTP_ACK:
+                    continue
+                # Map the 16-bit ACK back onto our absolute block numbers
+                base = acked - acked % SEQUENCE_SIZE
+                for cand in (base + seq - SEQUENCE_SIZE, base + seq,
+                             base + seq + SEQUENCE_SIZE):
+                    if acked <= cand <= last:
+                        got = cand
+                if got is not None:
+                    break
+            if got is None or got < last:
+                resent += 1
+            if got is not None:
+                acked = got
+        elapsed = time.time() - start
+        sock.close()
+
+        result = (name, len(self.data), blksize, windowsize, elapsed, resent)
+        self.results.append(result)
+        if not self.quiet:
+            print('%s: %d bytes, blksize %d, windowsize %d, %.3f s, '
+                  '%.2f MB/s, %d window(s) resent' %
+                  (name, len(self.data), blksize, windowsize, elapsed,
+                   len(self.data) / elapsed / 1e6, resent))
+
+
+def client(port, blksize, windowsize, timeout=0.2):
+    """Reference client following the rules of net/tftp.c
+
+    Returns the received data.
+    """
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(timeout)
+    rrq = struct.pack('>H', TFTP_RRQ) + b'test\0octet\0' + \
+        ('blksize\0%d\0' % blksize).encode()
+    if windowsize > 1:
+        rrq += ('windowsize\0%d\0' % windowsize).encode()
+    sock.sendto(rrq, ('127.0.0.1', port))
+
+    data = []
+    window = 1
+    last_block = 0
+    last_ack = None
+    count = 0
+    server = None
+
+    def send_ack(block):
+        sock.sendto(struct.pack('>HH', TFTP_ACK, block), server)
+        return block
+
+    while True:
+        try:
+            pkt, peer = sock.recvfrom(65536)
+        except socket.timeout:
+            if server is None:
+                sock.sendto(rrq, ('127.0.0.1', port))
+            else:
+                last_ack = send_ack(last_block)
+                count = 0
+            continue
+        server = peer
+        op = struct.unpack('>H', pkt[:2])[0]
+        if op == TFTP_OACK:
+            fields = pkt[2:].split(b'\0')
+            for i in range(0, len(fields) - 1, 2):
+                if fields[i] == b'blksize':
+                    blksize = int(fields[i + 1])
+                if fields[i] == b'windowsize':
+                    window = int(fields[i + 1])
+            last_ack = send_ack(0)
+            continue
+        if op != TFTP_DATA:
+            continue
+        block = struct.unpack('>H', pkt[2:4])[0]
+        if block == last_block:
+            continue
+        if window > 1 and block != (last_block + 1) % SEQUENCE_SIZE:
+            if last_ack != last_block:
+                last_ack = send_ack(last_block)
+                count = 0
+            continue
+        last_block = block
+        payload = pkt[4:]
+        data.append(payload)
+        count += 1
+        if count >= window or len(payload) < blksize:
+            last_ack = send_ack(last_block)
+            count = 0
+        if len(payload) < blksize:
+            break
+    sock.close()
+    return b''.join(data)
+
+
+def loopback(options, data):
+    server = Server(data, '127.0.0.1', 0, options.drop, options.reorder,
+                    timeout=0.2, quiet=True)
+    sizes = [int(w) for w in options.windows.split(',')]
+    thread = threading.Thread(target=server.serve_forever,
+                              args=(len(sizes),))
+    thread.daemon = True
+    thread.start()
+
+    print('%10s %10s %10s %10s' % ('windowsize', 'seconds', 'MB/s',
+                                   'resent'))
+    ok = True
+    for windowsize in sizes:
+        got = client(server.port, options.blksize, windowsize)
+        while len(server.results) == 0:
+            time.sleep(0.01)
+        _, size, _, _, elapsed, resent = server.results.pop()
+        if got != data:
+            print('windowsize %d: data mismatch' % windowsize)
+            ok = False
+        print('%10d %10.3f %10.2f %10d' % (windowsize, elapsed,
+                                            size / elapsed / 1e6, resent))
+    thread.join(1)
+    return ok
+
+
+def main():
+    parser = OptionParser()
+    parser.add_option('-a', '--addr', default='0.0.0.0',
+                      help='Address to listen on')
+    parser.add_option('-p', '--port', type='int', default=6969,
+                      help='UDP port to listen on')
+    parser.add_option('-f', '--file', help='File to serve')
+    parser.add_option('-s', '--size', default='4M',
+                      help='Size of generated data if no file is given')
+    parser.add_option('-b', '--blksize', type='int', default=1468,
+                      help='Block size requested in loopback mode')
+    parser.add_option('-w', '--windows', default='1,2,4,8,16,32',
+                      help='Window sizes tried in loopback mode')
+    parser.add_option('--drop', type='float', default=0.0,
+                      help='Probability of dropping a DATA packet')
+    parser.add_option('--reorder', type='float', default=0.0,
+                      help='Probability of swapping two DATA packets')
+    parser.add_option('--loopback', action='store_true',
+                      help='Run the reference client over 127.0.0.1')
+    (options, args) = parser.parse_args()
+
+    if options.file:
+        with open(options.file, 'rb') as fd:
+            data = fd.read()
+    else:
+        data = os.urandom(parse_size(options.size))
+
+    if options.loopback:
+        return 0 if loopback(options, data) else 1
+
+    Server(data, options.addr, options.port, options.drop,
+           options.reorder).serve_forever()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,164 @@
+/*
+ * Tests and a throughput benchmark for the SHA-256 block functions
+ *
+ * The known-answer tests go through sha256_update(), so they cover
+ * whichever block function the board selected. Every other variant is
+ * then checked bit for bit against the generic C code and timed.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <u-boot/sha256.h>
+
+/* Buffer for the cross-check and the benchmark, in 64-byte blocks */
+#define TEST_BLOCKS	1024
+#define TEST_SIZE	(TEST_BLOCKS * 64)
+
+/* Time each variant for at least this long */
+#define BENCH_MS	1000
+
+/* FIPS 180-2 appendix B, plus the empty message */
+static const struct sha256_vector {
+	const char *msg;
+	uint repeat;
+	u8 digest[SHA256_SUM_LEN];
+} vectors[] = {
+	{ "abc", 1, {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	} },
+	{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, {
+		0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+		0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+		0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+		0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+	} },
+	{ "aaaaaaaaaa", 100000, {
+		0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92,
+		0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+		0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+		0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0,
+	} },
+	{ "", 1, {
+		0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+		0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+		0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+		0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55,
+	} },
+};
+
+static int run_vectors(void)
+{
+	const struct sha256_vector *vec;
+	u8 digest[SHA256_SUM_LEN];
+	sha256_context ctx;
+	uint i;
+	int ret = 0;
+
+	for (vec = vectors; vec < vectors + ARRAY_SIZE(vectors); vec++) {
+		sha256_starts(&ctx);
+		for (i = 0; i < vec->repeat; i++)
+			sha256_update(&ctx, (const u8 *)vec->msg,
+				      strlen(vec->msg));
+		sha256_finish(&ctx, digest);
+		if (memcmp(digest, vec->digest, SHA256_SUM_LEN)) {
+			printf(" \"%s\" x %u: wrong digest\n", vec->msg,
+			       vec->repeat);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+/* Compare a variant with the generic code for each length and alignment */
+static int run_compare(const struct sha256_variant *var, const u8 *buf)
+{
+	uint32_t ref[8], state[8];
+	uint blocks, off;
+	int i;
+
+	for (blocks = 1; blocks <= 17; blocks++) {
+		for (off = 0; off < 4; off++) {
+			for (i = 0; i < 8; i++)
+				ref[i] = state[i] = 0x01234567 * (i + blocks);
+			sha256_variants[0].blocks(ref, buf + off, blocks);
+			var->blocks(state, buf + off, blocks);
+			if (memcmp(state, ref, sizeof(ref))) {
+				printf(" %s: %u blocks at offset %u differ\n",
+				       var->name, blocks, off);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void run_bench(const struct sha256_variant *var, const u8 *buf)
+{
+	uint32_t state[8] = { 0 };
+	ulong start, ms;
+	u64 bytes = 0, kib_s;
+
+	start = get_timer(0);
+	do {
+		var->blocks(state, buf, TEST_BLOCKS);
+		bytes += TEST_SIZE;
+		WATCHDOG_RESET();
+		ms = get_timer(start);
+	} while (ms < BENCH_MS);
+
+	kib_s = bytes * 1000;
+	do_div(kib_s, ms * 1024);
+	printf(" %-10s %7lu.%02lu MiB/s\n", var->name, (ulong)kib_s / 1024,
+	       ((ulong)kib_s % 1024) * 100 / 1024);
+}
+
+static int do_ut_sha256(cmd_tbl_t *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	const struct sha256_variant *var;
+	u32 seed = 1;
+	u8 *buf;
+	int i, err;
+
+	buf = malloc(TEST_SIZE + 4);
+	if (!buf)
+		return CMD_RET_FAILURE;
+	for (i = 0; i < TEST_SIZE + 4; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+
+	printf(" testing known answers ...\n");
+	err = run_vectors();
+	for (var = sha256_variants + 1; var->name; var++) {
+		printf(" comparing %s with %s ...\n", var->name,
+		       sha256_variants[0].name);
+		err += run_compare(var, buf);
+	}
+
+	if (!err) {
+		printf(" throughput:\n");
+		for (var = sha256_variants; var->name; var++)
+			run_bench(var, buf);
+	}
+	free(buf);
+
+	printf("ut_sha256 %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ut_sha256,	1,	1,	do_ut_sha256,
+	"Test and time the SHA-256 block functions", ""
+);
@@ -55,6 +55,8 @@ struct func_info *func_list;
 int func_count;
 struct trace_call *call_list;
 int call_count;
+struct trace_heap *heap_list;
+int heap_count;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
 
@@ -85,6 +87,7 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-heap\t\tReport peak and leaked heap use per call site\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
@@ -226,6 +229,27 @@ static int read_calls(FILE *fin, int count)
 	return 0;
 }
 
+static int read_heap(FILE *fin, int count)
+{
+	struct trace_heap *rec;
+	int i;
+
+	notice("heap record count: %d\n", count);
+	heap_list = (struct trace_heap *)calloc(count, sizeof(*rec));
+	if (!heap_list) {
+		error("Cannot allocate heap_list\n");
+		return -1;
+	}
+	heap_count = count;
+
+	rec = heap_list;
+	for (i = 0; i < count; i++, rec++) {
+		if (read_data(fin, rec, sizeof(*rec)))
+			return 1;
+	}
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -249,6 +273,11 @@ static int read_profile(FILE *fin, int *not_found)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_HEAP:
+			if (read_heap(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -531,6 +560,168 @@ static int make_ftrace(void)
 	return 0;
 }
 
+/* Heap use of one call site */
+struct heap_site {
+	uint32_t caller;		/* Offset of the return address */
+	unsigned long allocs;		/* Blocks allocated */
+	unsigned long total;		/* Bytes allocated */
+	unsigned long live;		/* Bytes not freed so far */
+	unsigned long live_blocks;
+	unsigned long peak;		/* Most bytes live at one time */
+};
+
+/* A block not freed so far, in a hash table on its address */
+struct heap_block {
+	uint32_t ptr;
+	uint32_t size;
+	int site;			/* or HEAP_SLOT_EMPTY/FREED */
+};
+
+enum {
+	HEAP_SLOT_EMPTY	= -1,
+	HEAP_SLOT_FREED	= -2,		/* Used once, keep probing past it */
+};
+
+static inline unsigned int heap_hash(uint32_t val, unsigned int size)
+{
+	return (val * 2654435761u) & (size - 1);
+}
+
+static struct heap_block *find_block(struct heap_block *blocks,
+				     unsigned int size, uint32_t ptr)
+{
+	unsigned int h;
+
+	for (h = heap_hash(ptr, size); blocks[h].site != HEAP_SLOT_EMPTY;
+	     h = (h + 1) & (size - 1)) {
+		if (blocks[h].site >= 0 && blocks[h].ptr == ptr)
+			return &blocks[h];
+	}
+
+	return NULL;
+}
+
+static int h_cmp_site(const void *v1, const void *v2)
+{
+	const struct heap_site *s1 = v1, *s2 = v2;
+
+	if (s1->peak != s2->peak)
+		return s1->peak < s2->peak ? 1 : -1;
+	if (s1->live != s2->live)
+		return s1->live < s2->live ? 1 : -1;
+	return 0;
+}
+
+/*
+ * Replay the heap trace and report, for each place that allocates, the
+ * most memory it had at any one time and what it never gave back.
+ */
+static int make_heap_report(void)
+{
+	unsigned long live = 0, peak = 0, peak_time = 0, unmatched = 0;
+	unsigned long leaked = 0, leaked_blocks = 0;
+	unsigned int size, h, nsites = 0;
+	struct heap_block *blocks, *block;
+	struct heap_site *sites, *site;
+	struct func_info *func;
+	struct trace_heap *rec;
+	int *site_index;
+	int i;
+
+	/* At most half full, so every probe ends at an empty slot */
+	for (size = 16; size < 2 * heap_count; size <<= 1)
+		;
+	sites = calloc(heap_count + 1, sizeof(*sites));
+	site_index = malloc(size * sizeof(*site_index));
+	blocks = malloc(size * sizeof(*blocks));
+	if (!sites || !site_index || !blocks) {
+		error("Cannot allocate heap report\n");
+		return -1;
+	}
+	for (h = 0; h < size; h++) {
+		site_index[h] = -1;
+		blocks[h].site = HEAP_SLOT_EMPTY;
+	}
+
+	for (i = 0, rec = heap_list; i < heap_count; i++, rec++) {
+		block = find_block(blocks, size, rec->ptr);
+		if (block) {
+			/* Freed, or its free() was lost */
+			site = &sites[block->site];
+			site->live -= block->size;
+			site->live_blocks--;
+			live -= block->size;
+			block->site = HEAP_SLOT_FREED;
+		} else if (TRACE_HEAP_TYPE(rec) == HEAPF_FREE) {
+			/* Allocated before the oldest record */
+			unmatched++;
+		}
+		if (TRACE_HEAP_TYPE(rec) == HEAPF_FREE)
+			continue;
+
+		for (h = heap_hash(rec->caller, size); site_index[h] != -1;
+		     h = (h + 1) & (size - 1)) {
+			if (sites[site_index[h]].caller == rec->caller)
+				break;
+		}
+		if (site_index[h] == -1) {
+			site_index[h] = nsites;
+			sites[nsites++].caller = rec->caller;
+		}
+		site = &sites[site_index[h]];
+		site->allocs++;
+		site->total += rec->size;
+		site->live += rec->size;
+		site->live_blocks++;
+		if (site->live > site->peak)
+			site->peak = site->live;
+		live += rec->size;
+		if (live > peak) {
+			peak = live;
+			peak_time = rec->flags & HEAPF_TIMESTAMP_MASK;
+		}
+
+		for (h = heap_hash(rec->ptr, size); blocks[h].site >= 0;
+		     h = (h + 1) & (size - 1))
+			;
+		blocks[h].ptr = rec->ptr;
+		blocks[h].size = rec->size;
+		blocks[h].site = site - sites;
+	}
+
+	qsort(sites, nsites, sizeof(*sites), h_cmp_site);
+	for (site = sites; site < sites + nsites; site++) {
+		leaked += site->live;
+		leaked_blocks += site->live_blocks;
+	}
+
+	printf("# Heap use by call site, from %d records\n", heap_count);
+	printf("# Peak %lu bytes at %lu.%06lu, %lu bytes in %lu blocks not freed\n",
+	       peak, peak_time / 1000000, peak_time % 1000000, leaked,
+	       leaked_blocks);
+	if (unmatched)
+		printf("# %lu blocks freed that were allocated before the trace starts\n",
+		       unmatched);
+	printf("#\n"
+	       "#       peak     leaked  blocks   allocs      total  site\n");
+	for (site = sites; site < sites + nsites; site++) {
+		printf("%12lu %10lu %7lu %8lu %10lu  ", site->peak, site->live,
+		       site->live_blocks, site->allocs, site->total);
+		func = find_caller_by_offset(site->caller);
+		if (func)
+			printf("%s+%#lx\n", func->name,
+			       site->caller - func->offset);
+		else
+			printf("%x\n", site->caller);
+	}
+
+	free(blocks);
+	free(site_index);
+	free(sites);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -551,6 +742,8 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-heap"))
+			err = make_heap_report();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}